@@ -0,0 +1,416 @@
+#include <ctime>
+#include <string>
+#include <vector>
+#include <array>
+#include <chrono>
+#include <random>
+#include <fstream>
+#include <iostream>
+#include <algorithm>
+#include <filesystem>
+#include <functional>
+#include <fmt/format.h>
+#include <winpp/hashpp.h>
+#if defined(__linux__)
+  #include <cstring>
+  #include <unistd.h>
+  #include <sys/syscall.h>
+  #include <linux/perf_event.h>
+#endif
+#if defined(_MSC_VER)
+  #include <intrin.h>
+#elif defined(__x86_64__) || defined(__i386__)
+  #include <x86intrin.h>
+#endif
+
+// benchmark of the hashpp algorithms:
+//   - memory:    hash a buffer already in memory
+//   - file-hot:  hash a file which is in the page-cache
+//   - file-cold: hash a file evicted from the page-cache (linux only)
+//   - kernel:    hash a file in the page-cache with the AF_ALG backend (linux, HASHPP_USE_AF_ALG)
+// reports MB/s, cycles/byte (tsc), cpu cost per byte (all threads, user and kernel) and per-call
+// latency percentiles, optionally as json
+namespace
+{
+  constexpr uint64_t KiB = 1024;
+  constexpr uint64_t MiB = 1024 * KiB;
+  constexpr uint64_t GiB = 1024 * MiB;
+
+  struct algorithm_info
+  {
+    hashpp::ALGORITHMS algorithm;
+    const char* name;
+    const char* digest_of_d;
+  };
+
+  // all algorithms with the expected digest of "d" (checked before benchmarking)
+  const std::vector<algorithm_info> algorithms = {
+    { hashpp::ALGORITHMS::MD5, "MD5", "8277e0910d750195b448797616e091ad" },
+    { hashpp::ALGORITHMS::MD4, "MD4", "5d3f7ed29552c4ab4612fb7686bb52bb" },
+    { hashpp::ALGORITHMS::MD2, "MD2", "96978c0796ce94f7beb31576946b6bed" },
+    { hashpp::ALGORITHMS::SHA1, "SHA1", "3c363836cf4e16666669a25da280a1865c2d2874" },
+    { hashpp::ALGORITHMS::SHA2_224, "SHA2-224", "06c9f71496e24dec6acc44895648cf9ec40b5cebb7bc4858a3c69f25" },
+    { hashpp::ALGORITHMS::SHA2_256, "SHA2-256", "18ac3e7343f016890c510e93f935261169d9e3f565436429830faf0934f4f8e4" },
+    { hashpp::ALGORITHMS::SHA2_384, "SHA2-384", "8ac10705a78a2dcd15fa577bac70762708597a02e130d8a6192d73dababd2b14502dbeee29d0e22bc341a0c42af6a4fb" },
+    { hashpp::ALGORITHMS::SHA2_512, "SHA2-512", "48fb10b15f3d44a09dc82d02b06581e0c0c69478c9fd2cf8f9093659019a1687baecdbb38c9e72b12169dc4148690f87467f9154f5931c5df665c6496cbfd5f5" },
+    { hashpp::ALGORITHMS::SHA2_512_224, "SHA2-512/224", "a8c9aa3f45f2ada72e3ae9278407b4ade221490596c69b27af611dae" },
+    { hashpp::ALGORITHMS::SHA2_512_256, "SHA2-512/256", "9a895196448c0a9daa9769b48f29db5b41cfe2f6f65943a8ef2b8f446e388f7e" }
+  };
+
+  // benchmark settings
+  struct settings
+  {
+    uint64_t min_size = 16;
+    uint64_t max_size = GiB;
+    double min_time = 0.5;
+    std::size_t max_iterations = 1000000;
+    std::vector<std::string> filter;
+    std::vector<std::string> cases = { "memory", "file-hot", "file-cold", "kernel" };
+    std::filesystem::path dir = std::filesystem::temp_directory_path();
+    std::filesystem::path json;
+  };
+
+  // result of one benchmark
+  struct result
+  {
+    std::string algorithm;
+    std::string name;
+    uint64_t size = 0;
+    std::size_t iterations = 0;
+    double mb_per_s = 0.0;
+    double cycles_per_byte = -1.0;
+    double cpu_per_byte = -1.0;             // cpu cycles (or cpu ns) per byte, see cpu_counter
+    std::array<double, 5> latency_ns = {};  // min, p50, p90, p99, max
+  };
+
+  // cpu used by the process and all its threads, user and kernel: the tsc only measures the elapsed
+  // time, the work done by the kernel (AF_ALG) or by the reader threads is only seen here
+  // counts the cpu cycles with perf_event (linux), the process cpu time in ns otherwise (std::clock outside of linux)
+  class cpu_counter final
+  {
+  public:
+    cpu_counter()
+    {
+#if defined(__linux__)
+      perf_event_attr attr;
+      std::memset(&attr, 0, sizeof(attr));
+      attr.type = PERF_TYPE_HARDWARE;
+      attr.size = sizeof(attr);
+      attr.config = PERF_COUNT_HW_CPU_CYCLES;
+      attr.inherit = 1;
+      m_fd = static_cast<int>(syscall(__NR_perf_event_open, &attr, 0, -1, -1, 0));
+#endif
+    }
+
+    cpu_counter(const cpu_counter&) = delete;
+    cpu_counter& operator=(const cpu_counter&) = delete;
+
+    ~cpu_counter()
+    {
+#if defined(__linux__)
+      if (m_fd >= 0)
+        ::close(m_fd);
+#endif
+    }
+
+    // true when the counter reports cycles, false when it reports cpu nanoseconds
+    bool cycles() const
+    {
+      return m_fd >= 0;
+    }
+
+    uint64_t read() const
+    {
+#if defined(__linux__)
+      uint64_t value = 0;
+      if (m_fd >= 0 && ::read(m_fd, &value, sizeof(value)) == sizeof(value))
+        return value;
+      timespec ts;
+      clock_gettime(CLOCK_PROCESS_CPUTIME_ID, &ts);
+      return static_cast<uint64_t>(ts.tv_sec) * 1000000000ull + static_cast<uint64_t>(ts.tv_nsec);
+#else
+      return static_cast<uint64_t>(static_cast<double>(std::clock()) * 1e9 / CLOCKS_PER_SEC);
+#endif
+    }
+
+  private:
+    int m_fd = -1;
+  };
+
+  // created before any reader thread so that they are counted too
+  const cpu_counter cpu;
+
+  // read the time-stamp counter (0 when not available)
+  inline uint64_t read_tsc()
+  {
+#if defined(_MSC_VER) || defined(__x86_64__) || defined(__i386__)
+    return __rdtsc();
+#else
+    return 0;
+#endif
+  }
+
+  // write a file of random data
+  void write_file(const std::filesystem::path& path, const uint64_t size)
+  {
+    std::ofstream file(path, std::ios::binary | std::ios::trunc);
+    if (!file)
+      throw std::runtime_error(fmt::format("can't create file: \"{}\"", path.u8string()));
+    std::mt19937_64 rng(size);
+    std::vector<uint64_t> buf(MiB / sizeof(uint64_t));
+    for (uint64_t written = 0; written < size;)
+    {
+      std::generate(buf.begin(), buf.end(), rng);
+      const std::size_t len = static_cast<std::size_t>(std::min<uint64_t>(MiB, size - written));
+      file.write(reinterpret_cast<const char*>(buf.data()), len);
+      written += len;
+    }
+  }
+
+  // evict a file from the page-cache, returns false if not supported
+  bool evict_file(const std::filesystem::path& path)
+  {
+#if defined(POSIX_FADV_DONTNEED)
+    const int fd = ::open(path.c_str(), O_RDONLY);
+    if (fd < 0)
+      return false;
+    fdatasync(fd);
+    const bool evicted = posix_fadvise(fd, 0, 0, POSIX_FADV_DONTNEED) == 0;
+    ::close(fd);
+    return evicted;
+#else
+    return false;
+#endif
+  }
+
+  // run one benchmark: 'run' hashes 'size' bytes, 'prepare' is called (untimed) before each run
+  result measure(const settings& cfg,
+                 const std::string& algorithm,
+                 const std::string& name,
+                 const uint64_t size,
+                 const std::function<void()>& run,
+                 const std::function<void()>& prepare = nullptr)
+  {
+    // group tiny inputs so that the clock resolution doesn't dominate the latency
+    const std::size_t batch = prepare ? 1 : static_cast<std::size_t>(std::max<uint64_t>(1, 4 * KiB / std::max<uint64_t>(size, 1)));
+    std::vector<double> latencies;
+    double total_ns = 0.0;
+    uint64_t total_cycles = 0;
+    uint64_t total_cpu = 0;
+    std::size_t iterations = 0;
+    while ((total_ns < cfg.min_time * 1e9 || iterations < 3 * batch) && iterations < cfg.max_iterations)
+    {
+      if (prepare)
+        prepare();
+      const auto start = std::chrono::steady_clock::now();
+      const uint64_t tsc = read_tsc();
+      const uint64_t used = cpu.read();
+      for (std::size_t i = 0; i < batch; ++i)
+        run();
+      total_cpu += cpu.read() - used;
+      total_cycles += read_tsc() - tsc;
+      const double ns = std::chrono::duration<double, std::nano>(std::chrono::steady_clock::now() - start).count();
+      total_ns += ns;
+      iterations += batch;
+      latencies.push_back(ns / static_cast<double>(batch));
+    }
+
+    result res;
+    res.algorithm = algorithm;
+    res.name = name;
+    res.size = size;
+    res.iterations = iterations;
+    const double bytes = static_cast<double>(size) * static_cast<double>(iterations);
+    res.mb_per_s = total_ns > 0.0 ? bytes / total_ns * 1e9 / MiB : 0.0;
+    if (total_cycles && bytes > 0.0)
+      res.cycles_per_byte = static_cast<double>(total_cycles) / bytes;
+    if (total_cpu && bytes > 0.0)
+      res.cpu_per_byte = static_cast<double>(total_cpu) / bytes;
+    std::sort(latencies.begin(), latencies.end());
+    const auto percentile = [&](const double p) -> double {
+      return latencies[std::min(latencies.size() - 1, static_cast<std::size_t>(p * static_cast<double>(latencies.size())))];
+    };
+    res.latency_ns = { latencies.front(), percentile(0.50), percentile(0.90), percentile(0.99), latencies.back() };
+    return res;
+  }
+
+  // human readable size
+  std::string to_size(const uint64_t size)
+  {
+    if (size >= GiB && size % GiB == 0) return fmt::format("{}GiB", size / GiB);
+    if (size >= MiB && size % MiB == 0) return fmt::format("{}MiB", size / MiB);
+    if (size >= KiB && size % KiB == 0) return fmt::format("{}KiB", size / KiB);
+    return fmt::format("{}B", size);
+  }
+
+  void print(const result& res)
+  {
+    const auto& per_byte = [](const double value) -> std::string {
+      return value < 0.0 ? std::string("n/a") : fmt::format("{:.2f}", value);
+    };
+    std::cout << fmt::format("{:<13} {:<10} {:>7} {:>10.1f} MB/s {:>9} c/B {:>9} cpu/B  p50 {:>12.0f} ns  p90 {:>12.0f} ns  p99 {:>12.0f} ns  ({} it)",
+                             res.algorithm, res.name, to_size(res.size), res.mb_per_s,
+                             per_byte(res.cycles_per_byte), per_byte(res.cpu_per_byte),
+                             res.latency_ns[1], res.latency_ns[2], res.latency_ns[3], res.iterations) << std::endl;
+  }
+
+  void write_json(const std::filesystem::path& path, const std::vector<result>& results)
+  {
+    std::ofstream file(path, std::ios::trunc);
+    if (!file)
+      throw std::runtime_error(fmt::format("can't create file: \"{}\"", path.u8string()));
+    file << "{\n";
+    file << fmt::format("  \"version\": \"{}\",\n", WINPP_VERSION);
+    file << fmt::format("  \"cpu_unit\": \"{}\",\n", cpu.cycles() ? "cycles" : "ns");
+    file << fmt::format("  \"timestamp\": {},\n", std::chrono::duration_cast<std::chrono::seconds>(std::chrono::system_clock::now().time_since_epoch()).count());
+    file << "  \"results\": [\n";
+    for (std::size_t i = 0; i < results.size(); ++i)
+    {
+      const result& r = results[i];
+      file << fmt::format("    {{ \"algorithm\": \"{}\", \"case\": \"{}\", \"size\": {}, \"iterations\": {}, \"mb_per_s\": {:.3f}, \"cycles_per_byte\": {}, \"cpu_per_byte\": {}, "
+                          "\"latency_ns\": {{ \"min\": {:.1f}, \"p50\": {:.1f}, \"p90\": {:.1f}, \"p99\": {:.1f}, \"max\": {:.1f} }} }}{}\n",
+                          r.algorithm, r.name, r.size, r.iterations, r.mb_per_s,
+                          r.cycles_per_byte < 0.0 ? std::string("null") : fmt::format("{:.4f}", r.cycles_per_byte),
+                          r.cpu_per_byte < 0.0 ? std::string("null") : fmt::format("{:.4f}", r.cpu_per_byte),
+                          r.latency_ns[0], r.latency_ns[1], r.latency_ns[2], r.latency_ns[3], r.latency_ns[4],
+                          i + 1 < results.size() ? "," : "");
+    }
+    file << "  ]\n}\n";
+  }
+
+  // split a comma separated list
+  std::vector<std::string> split(const std::string& str)
+  {
+    std::vector<std::string> items;
+    std::size_t start = 0;
+    for (std::size_t pos = str.find(','); ; pos = str.find(',', start))
+    {
+      items.push_back(str.substr(start, pos - start));
+      if (pos == std::string::npos)
+        break;
+      start = pos + 1;
+    }
+    return items;
+  }
+
+  void usage()
+  {
+    std::cout << "usage: hash-benchmark [options]\n"
+              << "  --min-size <bytes>      smallest input (default: 16)\n"
+              << "  --max-size <bytes>      largest input (default: 1073741824)\n"
+              << "  --min-time <seconds>    minimum time per benchmark (default: 0.5)\n"
+              << "  --algorithms <list>     comma separated algorithms (default: all)\n"
+              << "  --cases <list>          comma separated cases: memory,file-hot,file-cold,kernel (default: all)\n"
+              << "  --dir <directory>       directory for the temporary files (default: temp directory)\n"
+              << "  --json <file>           write the results as json\n";
+  }
+}
+
+int main(int argc, char** argv)
+{
+  try
+  {
+    settings cfg;
+    for (int i = 1; i < argc; ++i)
+    {
+      const std::string arg = argv[i];
+      if (arg == "-h" || arg == "--help")
+      {
+        usage();
+        return 0;
+      }
+      if (i + 1 >= argc)
+        throw std::runtime_error(fmt::format("missing value for: \"{}\"", arg));
+      const std::string value = argv[++i];
+      if (arg == "--min-size") cfg.min_size = std::stoull(value);
+      else if (arg == "--max-size") cfg.max_size = std::stoull(value);
+      else if (arg == "--min-time") cfg.min_time = std::stod(value);
+      else if (arg == "--algorithms") cfg.filter = split(value);
+      else if (arg == "--cases") cfg.cases = split(value);
+      else if (arg == "--dir") cfg.dir = value;
+      else if (arg == "--json") cfg.json = value;
+      else throw std::runtime_error(fmt::format("invalid argument: \"{}\"", arg));
+    }
+    const auto enabled = [&](const std::string& c) -> bool {
+      return std::find(cfg.cases.cbegin(), cfg.cases.cend(), c) != cfg.cases.cend();
+    };
+
+    // check each algorithm for correctness first
+    for (const auto& info : algorithms)
+    {
+      if (hashpp::get::getHash(info.algorithm, "d").getString() != info.digest_of_d)
+        throw std::runtime_error(fmt::format("algorithm {} returns an invalid digest", info.name));
+    }
+
+    // input sizes: powers of 4 from min_size to max_size
+    std::vector<uint64_t> sizes;
+    for (uint64_t size = 16; size <= cfg.max_size; size *= 4)
+    {
+      if (size >= cfg.min_size)
+        sizes.push_back(size);
+    }
+
+    std::vector<result> results;
+    const std::filesystem::path file = cfg.dir / "hash-benchmark.bin";
+    std::vector<uint8_t> data;
+    for (const uint64_t size : sizes)
+    {
+      if (enabled("memory"))
+      {
+        data.resize(static_cast<std::size_t>(size));
+        std::mt19937 rng(static_cast<unsigned>(size));
+        std::generate(data.begin(), data.end(), [&] { return static_cast<uint8_t>(rng()); });
+      }
+      const bool use_file = enabled("file-hot") || enabled("file-cold") || enabled("kernel");
+      if (use_file)
+        write_file(file, size);
+
+      for (const auto& info : algorithms)
+      {
+        if (!cfg.filter.empty() && std::find(cfg.filter.cbegin(), cfg.filter.cend(), info.name) == cfg.filter.cend())
+          continue;
+        const std::unique_ptr<hashpp::common> hasher = hashpp::get::getHasher(info.algorithm);
+
+        if (enabled("memory"))
+        {
+          uint8_t digest[64];
+          results.push_back(measure(cfg, info.name, "memory", size, [&] {
+            hasher->init();
+            hasher->update(data.data(), data.size());
+            hasher->finalize(digest);
+          }));
+          print(results.back());
+        }
+        if (enabled("file-hot"))
+        {
+          hasher->getHash(file);
+          results.push_back(measure(cfg, info.name, "file-hot", size, [&] { hasher->getHash(file); }));
+          print(results.back());
+        }
+        if (enabled("file-cold") && evict_file(file))
+        {
+          results.push_back(measure(cfg, info.name, "file-cold", size, [&] { hasher->getHash(file); }, [&] { evict_file(file); }));
+          print(results.back());
+        }
+#if defined(HASHPP_USE_AF_ALG) && defined(__linux__)
+        if (enabled("kernel") && hashpp::kernel::getFileHash(info.algorithm, file).valid())
+        {
+          results.push_back(measure(cfg, info.name, "kernel", size, [&] { hashpp::kernel::getFileHash(info.algorithm, file); }));
+          print(results.back());
+        }
+#endif
+      }
+      if (use_file)
+        std::filesystem::remove(file);
+    }
+
+    if (!cfg.json.empty())
+      write_json(cfg.json, results);
+    return 0;
+  }
+  catch (const std::exception& ex)
+  {
+    std::cerr << "error: " << ex.what() << std::endl;
+    return -1;
+  }
+}
@@ -0,0 +1,208 @@
+#pragma once
+#include <string>
+#include <vector>
+#include <array>
+#include <memory>
+#include <cstdint>
+#include <algorithm>
+#include <filesystem>
+#include <functional>
+#include <fmt/format.h>
+#include <winpp/hashpp.h>
+
+namespace files
+{
+  // default chunk sizes of the content-defined chunking
+  constexpr std::size_t default_cdc_min_size = 16 * 1024;
+  constexpr std::size_t default_cdc_avg_size = 64 * 1024;
+  constexpr std::size_t default_cdc_max_size = 256 * 1024;
+
+  // chunk of a file: position, size and hash of its content
+  struct chunk
+  {
+    uint64_t offset;
+    uint64_t length;
+    std::string hash;
+  };
+
+  namespace details
+  {
+    // gear table: one pseudo-random 64 bits value per byte (splitmix64, fixed seed)
+    constexpr std::array<uint64_t, 256> make_gear_table()
+    {
+      std::array<uint64_t, 256> table = {};
+      uint64_t state = 0x6a09e667f3bcc909ull;
+      for (auto& value : table)
+      {
+        uint64_t z = (state += 0x9e3779b97f4a7c15ull);
+        z = (z ^ (z >> 30)) * 0xbf58476d1ce4e5b9ull;
+        z = (z ^ (z >> 27)) * 0x94d049bb133111ebull;
+        value = z ^ (z >> 31);
+      }
+      return table;
+    }
+    constexpr std::array<uint64_t, 256> gear_table = make_gear_table();
+
+    // mask testing the n most significant bits of the fingerprint
+    constexpr uint64_t cdc_mask(const unsigned n)
+    {
+      return n == 0 ? 0 : (n >= 64 ? ~0ull : ~0ull << (64 - n));
+    }
+  }
+
+  // content-defined chunking (FastCDC): the chunk boundaries depend on the content and
+  // not on the offsets, so inserting or removing bytes only changes the chunks around
+  // the modification and the other chunks keep their hashes across versions of a file
+  //
+  // the data is streamed through update(), each chunk is reported with its hash as soon
+  // as its end is found, finalize() reports the last chunk
+  class chunker final
+  {
+  public:
+    using chunk_callback = std::function<void(const chunk&)>;
+
+    chunker(const hashpp::ALGORITHMS algorithm = hashpp::ALGORITHMS::SHA2_256,
+            const std::size_t min_size = default_cdc_min_size,
+            const std::size_t avg_size = default_cdc_avg_size,
+            const std::size_t max_size = default_cdc_max_size) :
+      m_hasher(hashpp::get::getHasher(algorithm)),
+      m_min_size(min_size),
+      m_avg_size(avg_size),
+      m_max_size(max_size),
+      m_mask_small(0),
+      m_mask_large(0),
+      m_offset(0),
+      m_length(0),
+      m_fingerprint(0)
+    {
+      if (!m_hasher)
+        throw std::runtime_error(fmt::format("invalid algorithm: {}", static_cast<int>(algorithm)));
+      if (min_size == 0 || min_size > avg_size || avg_size > max_size)
+        throw std::runtime_error(fmt::format("invalid chunk sizes: {}/{}/{}", min_size, avg_size, max_size));
+
+      // normalized chunking: harder to cut before the average size, easier after
+      unsigned bits = 0;
+      while ((static_cast<std::size_t>(1) << (bits + 1)) <= avg_size)
+        ++bits;
+      m_mask_small = details::cdc_mask(bits + 2);
+      m_mask_large = details::cdc_mask(bits > 2 ? bits - 2 : 0);
+      m_hasher->init();
+    }
+
+    // restart a new stream
+    void reset()
+    {
+      m_offset = 0;
+      m_length = 0;
+      m_fingerprint = 0;
+      m_hasher->init();
+    }
+
+    // chunk the next bytes of the stream
+    void update(const uint8_t* data, std::size_t len, const chunk_callback& on_chunk)
+    {
+      while (len)
+      {
+        bool boundary = false;
+        const std::size_t n = find_boundary(data, len, boundary);
+        m_hasher->update(data, n);
+        data += n;
+        len -= n;
+        if (boundary)
+          emit(on_chunk);
+      }
+    }
+
+    // report the last chunk of the stream
+    void finalize(const chunk_callback& on_chunk)
+    {
+      if (m_length)
+        emit(on_chunk);
+      reset();
+    }
+
+  private:
+    // number of bytes belonging to the current chunk, boundary is set if the chunk ends there
+    std::size_t find_boundary(const uint8_t* data, const std::size_t len, bool& boundary)
+    {
+      std::size_t i = 0;
+
+      // cut-point skipping: no boundary before the minimum size, no need to compute the fingerprint
+      if (m_length < m_min_size)
+      {
+        i = std::min(len, m_min_size - m_length);
+        m_length += i;
+        if (m_length < m_min_size)
+          return i;
+      }
+      if (m_length >= m_max_size)
+      {
+        boundary = true;
+        return i;
+      }
+
+      uint64_t fp = m_fingerprint;
+      const auto& gear = details::gear_table;
+      for (; i < len; ++i)
+      {
+        fp = (fp << 1) + gear[data[i]];
+        ++m_length;
+        const uint64_t mask = m_length < m_avg_size ? m_mask_small : m_mask_large;
+        if (!(fp & mask) || m_length >= m_max_size)
+        {
+          boundary = true;
+          return i + 1;
+        }
+      }
+      m_fingerprint = fp;
+      return len;
+    }
+
+    // report the current chunk and start the next one
+    void emit(const chunk_callback& on_chunk)
+    {
+      const chunk c = { m_offset, m_length, m_hasher->finalize() };
+      m_offset += m_length;
+      m_length = 0;
+      m_fingerprint = 0;
+      m_hasher->init();
+      if (on_chunk)
+        on_chunk(c);
+    }
+
+  private:
+    std::unique_ptr<hashpp::common> m_hasher;
+    std::size_t m_min_size;
+    std::size_t m_avg_size;
+    std::size_t m_max_size;
+    uint64_t m_mask_small;
+    uint64_t m_mask_large;
+    uint64_t m_offset;
+    std::size_t m_length;
+    uint64_t m_fingerprint;
+  };
+
+  // get the content-defined chunks of a file with their hashes
+  inline const std::vector<chunk> get_chunks(const std::filesystem::path& file,
+                                             const hashpp::ALGORITHMS& algorithm = hashpp::ALGORITHMS::SHA2_256,
+                                             const std::size_t min_size = default_cdc_min_size,
+                                             const std::size_t avg_size = default_cdc_avg_size,
+                                             const std::size_t max_size = default_cdc_max_size)
+  {
+    if (!std::filesystem::is_regular_file(file))
+      throw std::runtime_error(fmt::format("can't open file: \"{}\"", file.filename().u8string()));
+
+    std::vector<chunk> chunks;
+    const auto& on_chunk = [&](const chunk& c) { chunks.push_back(c); };
+    chunker cdc(algorithm, min_size, avg_size, max_size);
+    hashpp::io::reader reader(file);
+    const uint8_t* data = nullptr;
+    std::size_t len = 0;
+    while (reader.next(data, len))
+      cdc.update(data, len, on_chunk);
+    if (reader.failed())
+      throw std::runtime_error(fmt::format("can't read file: \"{}\"", file.filename().u8string()));
+    cdc.finalize(on_chunk);
+    return chunks;
+  }
+}
@@ -0,0 +1,463 @@
+#pragma once
+#include <string>
+#include <vector>
+#include <array>
+#include <memory>
+#include <cstring>
+#include <cstdint>
+#include <limits>
+#include <istream>
+#include <ostream>
+#include <fstream>
+#include <algorithm>
+#include <filesystem>
+#include <unordered_map>
+#include <fmt/format.h>
+#include <winpp/hashpp.h>
+
+namespace files
+{
+  // block size of the delta signatures (0: chosen from the size of the file)
+  constexpr std::size_t auto_block_size = 0;
+
+  // maximum size of the literal data of one delta instruction (longer runs are split)
+  constexpr std::size_t max_delta_literal = 64 * 1024;
+
+  // signature of a base file: weak rolling checksum and strong digest of each block
+  struct signature
+  {
+    hashpp::ALGORITHMS algorithm = hashpp::ALGORITHMS::MD5;
+    std::size_t block_size = 0;
+    uint64_t size = 0;
+    std::string hash;              // hash of the whole file
+    std::vector<uint32_t> weak;    // one checksum per block
+    std::vector<uint8_t> strong;   // one digest per block (digestSize(algorithm) bytes each)
+  };
+
+  // instruction of a delta: copy a range of the base file or insert literal data
+  struct delta_instruction
+  {
+    enum class type : uint8_t { copy, data };
+    type kind;
+    uint64_t offset;  // copy: offset in the base file
+    uint64_t length;
+    std::string data; // data: literal bytes
+  };
+
+  // delta transforming a base file into a target file
+  struct delta
+  {
+    hashpp::ALGORITHMS algorithm = hashpp::ALGORITHMS::MD5;
+    uint64_t size = 0;
+    std::string hash;              // hash of the whole target file
+    std::vector<delta_instruction> instructions;
+  };
+
+  namespace details
+  {
+    // rsync style weak checksum (adler-32 like): a = sum(x), b = sum((len - i) * x)
+    struct rolling_checksum
+    {
+      uint32_t a = 0;
+      uint32_t b = 0;
+
+      void init(const uint8_t* data, const std::size_t len)
+      {
+        a = b = 0;
+        for (std::size_t i = 0; i < len; ++i)
+        {
+          a += data[i];
+          b += a;
+        }
+      }
+
+      // slide the window by one byte
+      void roll(const uint8_t out, const uint8_t in, const std::size_t len)
+      {
+        a += static_cast<uint32_t>(in) - out;
+        b += a - static_cast<uint32_t>(len) * out;
+      }
+
+      uint32_t value() const
+      {
+        return (a & 0xffff) | (b << 16);
+      }
+    };
+
+    // block size of a file: ~sqrt(size) rounded to 1 KiB, between 4 KiB and 1 MiB
+    inline std::size_t delta_block_size(const uint64_t size)
+    {
+      std::size_t block = 4 * 1024;
+      while (block < 1024 * 1024 && static_cast<uint64_t>(block) * block < size)
+        block *= 2;
+      return block;
+    }
+
+    template <class T>
+    inline void write_value(std::ostream& out, const T& value)
+    {
+      out.write(reinterpret_cast<const char*>(&value), sizeof(value));
+    }
+    template <class T>
+    inline T read_value(std::istream& in)
+    {
+      T value{};
+      in.read(reinterpret_cast<char*>(&value), sizeof(value));
+      if (!in.good())
+        throw std::runtime_error("truncated delta stream");
+      return value;
+    }
+    inline void write_string(std::ostream& out, const std::string& str)
+    {
+      write_value<uint64_t>(out, str.size());
+      out.write(str.data(), static_cast<std::streamsize>(str.size()));
+    }
+    // read count elements: the sizes come from the stream, the storage grows by 1 MiB as the data
+    // arrives so that a corrupted size fails on the end of the stream instead of allocating it
+    template <class T, class Container>
+    inline void read_array(std::istream& in, Container& data, const uint64_t count)
+    {
+      constexpr uint64_t step = 1024 * 1024 / sizeof(T);
+      if (count > std::numeric_limits<std::size_t>::max() / sizeof(T))
+        throw std::runtime_error("invalid delta stream: size too large");
+      data.clear();
+      while (data.size() < count)
+      {
+        const std::size_t done = data.size();
+        const std::size_t len = static_cast<std::size_t>(std::min<uint64_t>(step, count - done));
+        data.resize(done + len);
+        in.read(reinterpret_cast<char*>(&data[done]), static_cast<std::streamsize>(len * sizeof(T)));
+        if (!in.good())
+          throw std::runtime_error("truncated delta stream");
+      }
+    }
+    inline std::string read_string(std::istream& in)
+    {
+      std::string str;
+      read_array<char>(in, str, read_value<uint64_t>(in));
+      return str;
+    }
+    constexpr std::array<char, 8> signature_magic = { 'W', 'P', 'P', 'S', 'I', 'G', '1', 0 };
+    constexpr std::array<char, 8> delta_magic = { 'W', 'P', 'P', 'D', 'L', 'T', '1', 0 };
+  }
+
+  // compute the signature of a base file (the whole file hash is computed in the same pass)
+  inline const signature get_signature(const std::filesystem::path& file,
+                                       const std::size_t block_size = auto_block_size,
+                                       const hashpp::ALGORITHMS& algorithm = hashpp::ALGORITHMS::MD5)
+  {
+    const hashpp::io::file input(file);
+    if (!input.valid())
+      throw std::runtime_error(fmt::format("can't open file: \"{}\"", file.filename().u8string()));
+
+    signature sig;
+    sig.algorithm = algorithm;
+    sig.size = input.size();
+    sig.block_size = block_size == auto_block_size ? details::delta_block_size(sig.size) : block_size;
+    const std::size_t digest_size = hashpp::digestSize(algorithm);
+    const std::unique_ptr<hashpp::common> block_hasher = hashpp::get::getHasher(algorithm);
+    const std::unique_ptr<hashpp::common> file_hasher = hashpp::get::getHasher(algorithm);
+    if (!block_hasher || !file_hasher)
+      throw std::runtime_error(fmt::format("invalid algorithm: {}", static_cast<int>(algorithm)));
+
+    // read several blocks at once
+    const std::size_t blocks_per_read = std::max<std::size_t>(1, hashpp::io::defaultBufferSize / sig.block_size);
+    std::vector<uint8_t> buf(blocks_per_read * sig.block_size);
+    file_hasher->init();
+    uint64_t offset = 0;
+    for (;;)
+    {
+      const std::size_t n = input.readAt(offset, buf.data(), buf.size());
+      file_hasher->update(buf.data(), n);
+      for (std::size_t pos = 0; pos < n; pos += sig.block_size)
+      {
+        const std::size_t len = std::min(sig.block_size, n - pos);
+        details::rolling_checksum weak;
+        weak.init(buf.data() + pos, len);
+        sig.weak.push_back(weak.value());
+        sig.strong.resize(sig.strong.size() + digest_size);
+        block_hasher->init();
+        block_hasher->update(buf.data() + pos, len);
+        block_hasher->finalize(sig.strong.data() + sig.strong.size() - digest_size);
+      }
+      offset += n;
+      if (n < buf.size())
+        break;
+    }
+    sig.size = offset;
+    sig.hash = file_hasher->finalize();
+    return sig;
+  }
+
+  // compute the delta between a base file (known by its signature) and a target file:
+  // the target is scanned with the rolling checksum, the windows whose weak checksum
+  // matches a block of the base are confirmed with the strong digest
+  inline const delta get_delta(const signature& base, const std::filesystem::path& file)
+  {
+    const hashpp::io::file input(file);
+    if (!input.valid())
+      throw std::runtime_error(fmt::format("can't open file: \"{}\"", file.filename().u8string()));
+    if (base.block_size == 0)
+      throw std::runtime_error("invalid signature: block size is 0");
+
+    const std::size_t block = base.block_size;
+    const std::size_t digest_size = hashpp::digestSize(base.algorithm);
+    const std::size_t full_blocks = static_cast<std::size_t>(base.size / block);
+    const std::unique_ptr<hashpp::common> block_hasher = hashpp::get::getHasher(base.algorithm);
+    const std::unique_ptr<hashpp::common> file_hasher = hashpp::get::getHasher(base.algorithm);
+    if (!block_hasher || !file_hasher || base.weak.size() * digest_size != base.strong.size())
+      throw std::runtime_error("invalid signature");
+
+    // full blocks of the base by weak checksum (the last, shorter, block is only matched at the end)
+    std::unordered_map<uint32_t, std::vector<std::size_t>> blocks;
+    blocks.reserve(full_blocks);
+    for (std::size_t i = 0; i < full_blocks; ++i)
+      blocks[base.weak[i]].push_back(i);
+
+    delta result;
+    result.algorithm = base.algorithm;
+    std::string literal;
+    const auto& flush_literal = [&]() {
+      if (literal.empty())
+        return;
+      result.instructions.push_back({ delta_instruction::type::data, 0, literal.size(), std::move(literal) });
+      literal.clear();
+    };
+    const auto& add_copy = [&](const uint64_t offset, const uint64_t length) {
+      flush_literal();
+      auto& instructions = result.instructions;
+      if (!instructions.empty() && instructions.back().kind == delta_instruction::type::copy &&
+          instructions.back().offset + instructions.back().length == offset)
+        instructions.back().length += length;
+      else
+        instructions.push_back({ delta_instruction::type::copy, offset, length, {} });
+    };
+
+    // strong digest of the window, computed only when a weak checksum matches
+    std::vector<uint8_t> digest(digest_size);
+    const auto& strong_of = [&](const uint8_t* data, const std::size_t len) {
+      block_hasher->init();
+      block_hasher->update(data, len);
+      block_hasher->finalize(digest.data());
+    };
+    std::size_t next_expected = 0;
+    const auto& find_block = [&](const uint32_t weak, const uint8_t* data) -> std::ptrdiff_t {
+      const auto it = blocks.find(weak);
+      if (it == blocks.end())
+        return -1;
+      strong_of(data, block);
+      // prefer the block following the last match (unchanged regions are sequential)
+      std::ptrdiff_t found = -1;
+      for (const std::size_t i : it->second)
+      {
+        if (std::memcmp(base.strong.data() + i * digest_size, digest.data(), digest_size) == 0)
+        {
+          found = static_cast<std::ptrdiff_t>(i);
+          if (i == next_expected)
+            break;
+        }
+      }
+      return found;
+    };
+
+    // sliding window over the target file: buf[pos, end) holds the bytes not consumed yet
+    std::vector<uint8_t> buf(std::max(block * 4, hashpp::io::defaultBufferSize));
+    std::size_t pos = 0, end = 0;
+    uint64_t file_offset = 0;
+    bool eof = false;
+    file_hasher->init();
+    const auto& fill = [&]() {
+      std::memmove(buf.data(), buf.data() + pos, end - pos);
+      file_offset += pos;
+      end -= pos;
+      pos = 0;
+      const std::size_t n = input.readAt(file_offset + end, buf.data() + end, buf.size() - end);
+      file_hasher->update(buf.data() + end, n);
+      eof = n < buf.size() - end;
+      end += n;
+    };
+
+    details::rolling_checksum weak;
+    bool rolling = false;
+    fill();
+    for (;;)
+    {
+      if (end - pos < block && !eof)
+      {
+        fill();
+        rolling = false;
+        continue;
+      }
+      if (end - pos < block)
+        break;
+      if (!rolling)
+      {
+        weak.init(buf.data() + pos, block);
+        rolling = true;
+      }
+
+      const std::ptrdiff_t match = full_blocks ? find_block(weak.value(), buf.data() + pos) : -1;
+      if (match >= 0)
+      {
+        add_copy(static_cast<uint64_t>(match) * block, block);
+        next_expected = static_cast<std::size_t>(match) + 1;
+        pos += block;
+        rolling = false;
+        continue;
+      }
+
+      // no match: the first byte of the window becomes literal data
+      literal += static_cast<char>(buf[pos]);
+      if (literal.size() == max_delta_literal)
+        flush_literal();
+      if (pos + block < end)
+        weak.roll(buf[pos], buf[pos + block], block);
+      else
+        rolling = false;
+      ++pos;
+    }
+
+    // tail shorter than a block: match it with the last block of the base
+    const std::size_t tail = end - pos;
+    const std::size_t last = base.weak.size() - 1;
+    if (tail && base.weak.size() > full_blocks && base.size - static_cast<uint64_t>(last) * block == tail)
+    {
+      strong_of(buf.data() + pos, tail);
+      if (std::memcmp(base.strong.data() + last * digest_size, digest.data(), digest_size) == 0)
+      {
+        add_copy(static_cast<uint64_t>(last) * block, tail);
+        pos = end;
+      }
+    }
+    literal.append(reinterpret_cast<const char*>(buf.data() + pos), end - pos);
+    flush_literal();
+
+    result.size = file_offset + end;
+    result.hash = file_hasher->finalize();
+    return result;
+  }
+
+  // apply a delta to a base file: the output is hashed while it is written and checked against the delta
+  inline void apply_delta(const std::filesystem::path& base, const delta& d, const std::filesystem::path& output)
+  {
+    const hashpp::io::file input(base);
+    if (!input.valid())
+      throw std::runtime_error(fmt::format("can't open file: \"{}\"", base.filename().u8string()));
+    std::ofstream out(output, std::ios::binary | std::ios::trunc);
+    if (!out.good())
+      throw std::runtime_error(fmt::format("can't create file: \"{}\"", output.filename().u8string()));
+    const std::unique_ptr<hashpp::common> hasher = hashpp::get::getHasher(d.algorithm);
+    if (!hasher)
+      throw std::runtime_error(fmt::format("invalid algorithm: {}", static_cast<int>(d.algorithm)));
+
+    hasher->init();
+    const auto& write = [&](const void* data, const std::size_t len) {
+      out.write(static_cast<const char*>(data), static_cast<std::streamsize>(len));
+      hasher->update(static_cast<const uint8_t*>(data), len);
+    };
+    std::vector<uint8_t> buf;
+    for (const auto& instruction : d.instructions)
+    {
+      if (instruction.kind == delta_instruction::type::data)
+      {
+        write(instruction.data.data(), instruction.data.size());
+        continue;
+      }
+      buf.resize(static_cast<std::size_t>(std::min<uint64_t>(instruction.length, hashpp::io::defaultBufferSize)));
+      for (uint64_t done = 0; done < instruction.length;)
+      {
+        const std::size_t len = static_cast<std::size_t>(std::min<uint64_t>(buf.size(), instruction.length - done));
+        if (input.readAt(instruction.offset + done, buf.data(), len) != len)
+          throw std::runtime_error(fmt::format("base file is too short: \"{}\"", base.filename().u8string()));
+        write(buf.data(), len);
+        done += len;
+      }
+    }
+    out.close();
+    if (out.fail())
+      throw std::runtime_error(fmt::format("can't write file: \"{}\"", output.filename().u8string()));
+    if (hasher->finalize() != d.hash)
+      throw std::runtime_error(fmt::format("invalid hash after applying the delta: \"{}\"", output.filename().u8string()));
+  }
+
+  // serialize a signature (to send it to the side having the target file)
+  inline void write_signature(std::ostream& out, const signature& sig)
+  {
+    out.write(details::signature_magic.data(), details::signature_magic.size());
+    details::write_value<uint32_t>(out, static_cast<uint32_t>(sig.algorithm));
+    details::write_value<uint64_t>(out, sig.block_size);
+    details::write_value<uint64_t>(out, sig.size);
+    details::write_string(out, sig.hash);
+    details::write_value<uint64_t>(out, sig.weak.size());
+    out.write(reinterpret_cast<const char*>(sig.weak.data()), static_cast<std::streamsize>(sig.weak.size() * sizeof(uint32_t)));
+    out.write(reinterpret_cast<const char*>(sig.strong.data()), static_cast<std::streamsize>(sig.strong.size()));
+  }
+
+  inline const signature read_signature(std::istream& in)
+  {
+    std::array<char, 8> magic;
+    in.read(magic.data(), magic.size());
+    if (!in.good() || magic != details::signature_magic)
+      throw std::runtime_error("invalid signature stream");
+    signature sig;
+    sig.algorithm = static_cast<hashpp::ALGORITHMS>(details::read_value<uint32_t>(in));
+    sig.block_size = static_cast<std::size_t>(details::read_value<uint64_t>(in));
+    sig.size = details::read_value<uint64_t>(in);
+    sig.hash = details::read_string(in);
+    details::read_array<uint32_t>(in, sig.weak, details::read_value<uint64_t>(in));
+    details::read_array<uint8_t>(in, sig.strong, sig.weak.size() * hashpp::digestSize(sig.algorithm));
+    return sig;
+  }
+
+  // serialize a delta (to send it to the side having the base file)
+  inline void write_delta(std::ostream& out, const delta& d)
+  {
+    out.write(details::delta_magic.data(), details::delta_magic.size());
+    details::write_value<uint32_t>(out, static_cast<uint32_t>(d.algorithm));
+    details::write_value<uint64_t>(out, d.size);
+    details::write_string(out, d.hash);
+    details::write_value<uint64_t>(out, d.instructions.size());
+    for (const auto& instruction : d.instructions)
+    {
+      details::write_value<uint8_t>(out, static_cast<uint8_t>(instruction.kind));
+      if (instruction.kind == delta_instruction::type::copy)
+      {
+        details::write_value<uint64_t>(out, instruction.offset);
+        details::write_value<uint64_t>(out, instruction.length);
+      }
+      else
+        details::write_string(out, instruction.data);
+    }
+  }
+
+  inline const delta read_delta(std::istream& in)
+  {
+    std::array<char, 8> magic;
+    in.read(magic.data(), magic.size());
+    if (!in.good() || magic != details::delta_magic)
+      throw std::runtime_error("invalid delta stream");
+    delta d;
+    d.algorithm = static_cast<hashpp::ALGORITHMS>(details::read_value<uint32_t>(in));
+    d.size = details::read_value<uint64_t>(in);
+    d.hash = details::read_string(in);
+    // each instruction is at least 9 bytes of the stream: the list grows as they are read
+    const uint64_t count = details::read_value<uint64_t>(in);
+    for (uint64_t i = 0; i < count; ++i)
+    {
+      delta_instruction& instruction = d.instructions.emplace_back();
+      instruction.kind = static_cast<delta_instruction::type>(details::read_value<uint8_t>(in));
+      if (instruction.kind == delta_instruction::type::copy)
+      {
+        instruction.offset = details::read_value<uint64_t>(in);
+        instruction.length = details::read_value<uint64_t>(in);
+      }
+      else
+      {
+        instruction.data = details::read_string(in);
+        instruction.offset = 0;
+        instruction.length = instruction.data.size();
+      }
+    }
+    return d;
+  }
+}
@@ -7,10 +7,38 @@
 #include <algorithm>
 #include <iomanip>
 #include <functional>
+#include <memory>
+#include <atomic>
+#include <map>
+#include <thread>
+#include <mutex>
+#include <exception>
+#include <iterator>
+#include <utility>
+#include <tuple>
+#include <deque>
+#include <condition_variable>
+#include <string_view>
+#include <array>
+#include <unordered_set>
+#include <type_traits>
+#include <cstring>
 #include <sys/stat.h>
 #include <fmt/format.h>
+#if defined(_WIN32)
 #include <windows.h>
+#else
+#include <fcntl.h>
+#include <cerrno>
+#include <unistd.h>
+#if defined(__linux__)
+#include <dirent.h>
+#include <sys/mman.h>
+#include <sys/syscall.h>
+#endif
+#endif
 #include <winpp/hashpp.h>
+#include <winpp/pattern.hpp>
 
 namespace files
 {
@@ -19,32 +47,444 @@ namespace files
   const std::regex all_dirs = std::regex(R"(.*)");
   const std::regex all_files = std::regex(R"(.*)");
 
-  // get all directories and sub-directories with filtering (using a std::function)
-  inline const std::vector<std::filesystem::path> get_dirs(const std::filesystem::path& path,
-                                                           const int depth,
-                                                           const std::function<bool(const std::filesystem::path&)>& dir_filter)
+  // default bound of the directories waiting in the queues of a parallel walk
+  constexpr std::size_t default_max_pending = 512;
+
+  // options of the parallel walk of a directory
+  struct parallel_options
   {
-    const auto& check_depth = [](const int max_depth, const int current_depth) -> bool {
-      return (max_depth == infinite_depth) ? true : (current_depth <= max_depth);
+    std::size_t threads = 0;                        // number of threads (0: one per core)
+    std::size_t max_pending = default_max_pending;  // directories waiting to be stolen, the others are walked in place
+    bool sorted = true;                             // sort the results (otherwise in the order of discovery)
+  };
+
+  // identity of a file: device and inode (volume serial number and file index on windows)
+  struct file_id
+  {
+    uint64_t device;
+    uint64_t index;
+
+    bool operator==(const file_id& other) const
+    {
+      return device == other.device && index == other.index;
+    }
+  };
+
+  struct file_id_hash
+  {
+    std::size_t operator()(const file_id& id) const
+    {
+      return std::hash<uint64_t>()(id.index * 0x9e3779b97f4a7c15ull ^ id.device);
+    }
+  };
+
+  namespace details
+  {
+    // identity of the entry being visited by the walker of the current thread, known from the directory
+    // listing: the filters called from the visitor can use it instead of a stat (or an open on windows)
+    struct walk_entry
+    {
+      const std::filesystem::path* path = nullptr;
+      file_id id = {};
     };
-    const auto& check_dir = [=](const std::filesystem::path& p, const int d) -> bool {     
-      return std::filesystem::is_directory(p) && check_depth(depth, d) && dir_filter(p);
+    inline thread_local walk_entry current_entry;
+
+    // called for each entry found while walking a directory: returns true to descend into a directory
+    using walk_visitor = std::function<bool(const std::filesystem::path& p, const bool is_dir, const int depth)>;
+
+    // visit an entry with its identity from the listing: current_entry only points to the path (on the stack
+    // of the listing) during the call, the previous value is restored on return and on exception
+    inline bool visit_entry(const walk_visitor& visit, const std::filesystem::path& p, const bool is_dir, const int depth,
+                            const walk_entry& entry)
+    {
+      struct restore
+      {
+        walk_entry previous;
+        ~restore() { current_entry = previous; }
+      } guard{ current_entry };
+      current_entry = entry;
+      return visit(p, is_dir, depth);
+    }
+
+#if defined(__linux__)
+    // open directory: its sub-directories are opened relative to it (no path resolution from the root)
+    class dir_handle final
+    {
+    public:
+      explicit dir_handle(const int fd = -1) :
+        m_fd(fd)
+      {
+      }
+
+      dir_handle(dir_handle&& other) noexcept :
+        m_fd(other.m_fd)
+      {
+        other.m_fd = -1;
+      }
+
+      dir_handle& operator=(dir_handle&& other) noexcept
+      {
+        std::swap(m_fd, other.m_fd);
+        return *this;
+      }
+
+      dir_handle(const dir_handle&) = delete;
+      dir_handle& operator=(const dir_handle&) = delete;
+
+      ~dir_handle()
+      {
+        if (m_fd >= 0)
+          ::close(m_fd);
+      }
+
+      int get() const
+      {
+        return m_fd;
+      }
+
+    private:
+      int m_fd;
     };
 
-    if (!std::filesystem::is_directory(path))
-      throw std::runtime_error(fmt::format("invalid directory: \"{}\"", path.u8string()));
+    inline dir_handle open_dir(const std::filesystem::path& dir)
+    {
+      dir_handle handle(::open(dir.c_str(), O_RDONLY | O_DIRECTORY | O_CLOEXEC));
+      if (handle.get() < 0)
+        throw std::runtime_error(fmt::format("can't open directory: \"{}\"", dir.u8string()));
+      return handle;
+    }
+#else
+    // the directories are listed by path: nothing to keep open
+    struct dir_handle
+    {
+    };
 
-    std::vector<std::filesystem::path> dirs;
-    if (check_dir(path, 0))
-      dirs.push_back(path);
-    auto entry = std::filesystem::recursive_directory_iterator(path);
-    while (entry != std::filesystem::recursive_directory_iterator())
+    inline dir_handle open_dir(const std::filesystem::path&)
     {
-      if (check_dir(entry->path(), entry.depth()))
-        dirs.push_back(entry->path());
-      ++entry;
+      return dir_handle();
+    }
+#endif
+
+    // called for each sub-directory to descend into
+    using walk_descend = std::function<void(dir_handle&& handle, const std::filesystem::path& dir, const int depth)>;
+
+#if defined(_WIN32)
+    // list a directory with GetFileInformationByHandleEx (FileIdBothDirectoryInfo): the attributes and
+    // the file index come with the names (no query per entry)
+    inline void list_dir(const dir_handle&, const std::filesystem::path& dir, const int depth,
+                         const walk_visitor& visit, const walk_descend& descend, const std::atomic<bool>& stop)
+    {
+      const HANDLE handle = CreateFileW(dir.c_str(), FILE_LIST_DIRECTORY, FILE_SHARE_READ | FILE_SHARE_WRITE | FILE_SHARE_DELETE,
+                                        nullptr, OPEN_EXISTING, FILE_FLAG_BACKUP_SEMANTICS, nullptr);
+      if (handle == INVALID_HANDLE_VALUE)
+        throw std::runtime_error(fmt::format("can't open directory: \"{}\"", dir.u8string()));
+      const std::unique_ptr<void, decltype(&CloseHandle)> guard(handle, &CloseHandle);
+      BY_HANDLE_FILE_INFORMATION dir_info;
+      if (!GetFileInformationByHandle(handle, &dir_info))
+        throw std::runtime_error(fmt::format("can't read directory: \"{}\"", dir.u8string()));
+
+      // 64 KiB: the largest buffer accepted by the network file systems (8 bytes aligned)
+      std::vector<uint64_t> buffer(64 * 1024 / sizeof(uint64_t));
+      FILE_INFO_BY_HANDLE_CLASS info_class = FileIdBothDirectoryRestartInfo;
+      while (GetFileInformationByHandleEx(handle, info_class, buffer.data(), static_cast<DWORD>(buffer.size() * sizeof(uint64_t))))
+      {
+        info_class = FileIdBothDirectoryInfo;
+        const char* pos = reinterpret_cast<const char*>(buffer.data());
+        for (;;)
+        {
+          if (stop)
+            return;
+          const auto* info = reinterpret_cast<const FILE_ID_BOTH_DIR_INFO*>(pos);
+          const std::wstring_view name(info->FileName, info->FileNameLength / sizeof(wchar_t));
+          if (name != L"." && name != L"..")
+          {
+            const bool is_dir = (info->FileAttributes & FILE_ATTRIBUTE_DIRECTORY) != 0;
+            const bool is_link = (info->FileAttributes & FILE_ATTRIBUTE_REPARSE_POINT) != 0;
+            const uint64_t index = static_cast<uint64_t>(info->FileId.QuadPart);
+
+            // the identity of a link is the one of its target, the file systems without file index report 0
+            const std::filesystem::path p = dir / name;
+            const walk_entry entry = (!is_link && index) ? walk_entry{ &p, { dir_info.dwVolumeSerialNumber, index } } : walk_entry();
+            if (visit_entry(visit, p, is_dir, depth, entry) && is_dir && !is_link)
+              descend(dir_handle(), p, depth + 1);
+          }
+          if (!info->NextEntryOffset)
+            break;
+          pos += info->NextEntryOffset;
+        }
+      }
+      if (GetLastError() != ERROR_NO_MORE_FILES)
+        throw std::runtime_error(fmt::format("can't read directory: \"{}\"", dir.u8string()));
+    }
+#elif defined(__linux__)
+    // raw record returned by getdents64
+    struct linux_dirent64
+    {
+      uint64_t d_ino;
+      int64_t d_off;
+      unsigned short d_reclen;
+      unsigned char d_type;
+      char d_name[1];
+    };
+
+    // list a directory with large getdents64 buffers: the type comes with the names (stat only if unknown)
+    inline void list_dir(const dir_handle& handle, const std::filesystem::path& dir, const int depth,
+                         const walk_visitor& visit, const walk_descend& descend, const std::atomic<bool>& stop)
+    {
+      const int fd = handle.get();
+      struct stat dir_st;
+      if (::fstat(fd, &dir_st) != 0)
+        throw std::runtime_error(fmt::format("can't read directory: \"{}\"", dir.u8string()));
+      std::vector<std::tuple<std::string, unsigned char, uint64_t>> entries;
+      std::vector<char> buffer(256 * 1024);
+      while (true)
+      {
+        const long n = ::syscall(SYS_getdents64, fd, buffer.data(), buffer.size());
+        if (n < 0)
+          throw std::runtime_error(fmt::format("can't read directory: \"{}\"", dir.u8string()));
+        if (n == 0)
+          break;
+        for (long pos = 0; pos < n;)
+        {
+          const auto* entry = reinterpret_cast<const linux_dirent64*>(buffer.data() + pos);
+          pos += entry->d_reclen;
+          const std::string_view name(entry->d_name);
+          if (name != "." && name != "..")
+            entries.emplace_back(name, entry->d_type, entry->d_ino);
+        }
+      }
+
+      for (const auto& [name, type, inode] : entries)
+      {
+        if (stop)
+          return;
+        // symbolic links are reported with their target type but never followed
+        bool is_dir = (type == DT_DIR);
+        bool is_link = (type == DT_LNK);
+        if (type == DT_UNKNOWN)
+        {
+          struct stat st;
+          if (::fstatat(fd, name.c_str(), &st, AT_SYMLINK_NOFOLLOW) == 0)
+          {
+            is_dir = S_ISDIR(st.st_mode);
+            is_link = S_ISLNK(st.st_mode);
+          }
+        }
+        if (is_link)
+        {
+          struct stat st;
+          is_dir = (::fstatat(fd, name.c_str(), &st, 0) == 0) && S_ISDIR(st.st_mode);
+        }
+
+        // the identity of a link is the one of its target: unknown from the listing
+        const std::filesystem::path p = dir / name;
+        const walk_entry entry = is_link ? walk_entry() : walk_entry{ &p, { static_cast<uint64_t>(dir_st.st_dev), inode } };
+        if (visit_entry(visit, p, is_dir, depth, entry) && is_dir && !is_link)
+        {
+          dir_handle child(::openat(fd, name.c_str(), O_RDONLY | O_DIRECTORY | O_NOFOLLOW | O_CLOEXEC));
+          if (child.get() < 0)
+            throw std::runtime_error(fmt::format("can't open directory: \"{}\"", p.u8string()));
+          descend(std::move(child), p, depth + 1);
+        }
+      }
+    }
+#else
+    inline void list_dir(const dir_handle&, const std::filesystem::path& dir, const int depth,
+                         const walk_visitor& visit, const walk_descend& descend, const std::atomic<bool>& stop)
+    {
+      for (const auto& entry : std::filesystem::directory_iterator(dir))
+      {
+        if (stop)
+          return;
+        const bool is_dir = entry.is_directory();
+        if (visit(entry.path(), is_dir, depth) && is_dir && !entry.is_symlink())
+          descend(dir_handle(), entry.path(), depth + 1);
+      }
+    }
+#endif
+
+    // walk a directory tree depth-first (pre-order, the entries of the root are at depth 0) until stop is set
+    inline void walk(const std::filesystem::path& root, const walk_visitor& visit, const std::atomic<bool>& stop)
+    {
+      walk_descend descend = [&](dir_handle&& handle, const std::filesystem::path& dir, const int depth) {
+        list_dir(handle, dir, depth, visit, descend, stop);
+      };
+      descend(open_dir(root), root, 0);
+    }
+
+    // called for each entry by a worker of a parallel walk
+    using parallel_visitor = std::function<bool(const std::filesystem::path& p, const bool is_dir, const int depth, const std::size_t worker)>;
+
+    // parallel walk of a directory tree: each worker has its own queue of directories to list and
+    // the idle workers steal the directories waiting in the queues of the others
+    class parallel_walker final
+    {
+    public:
+      parallel_walker(const std::size_t threads, const std::size_t max_pending, const parallel_visitor& visit) :
+        m_visit(visit),
+        m_max_pending(max_pending),
+        m_queues(),
+        m_queued(0),
+        m_pending(0),
+        m_stop(false),
+        m_mutex(),
+        m_wakeup(),
+        m_error()
+      {
+        for (std::size_t i = 0; i < std::max<std::size_t>(threads, 1); ++i)
+          m_queues.emplace_back(std::make_unique<worker_queue>());
+      }
+
+      // walk the tree: the visitor is called concurrently by all the workers
+      void run(const std::filesystem::path& root)
+      {
+        push(0, task{ open_dir(root), root, 0 });
+        std::vector<std::thread> threads;
+        for (std::size_t i = 1; i < m_queues.size(); ++i)
+          threads.emplace_back([this, i]() { work(i); });
+        work(0);
+        for (auto& t : threads)
+          t.join();
+        if (m_error)
+          std::rethrow_exception(m_error);
+      }
+
+    private:
+      struct task
+      {
+        dir_handle handle;
+        std::filesystem::path dir;
+        int depth;
+      };
+
+      struct worker_queue
+      {
+        std::mutex mutex;
+        std::deque<task> tasks;
+      };
+
+      void push(const std::size_t worker, task&& t)
+      {
+        {
+          std::lock_guard<std::mutex> lck(m_queues[worker]->mutex);
+          m_queues[worker]->tasks.push_back(std::move(t));
+          ++m_pending;
+          ++m_queued;
+        }
+        std::lock_guard<std::mutex> lck(m_mutex);
+        m_wakeup.notify_one();
+      }
+
+      // the owner takes its most recent directory (depth-first: the parent entries are still cached)
+      bool pop(const std::size_t worker, task& t)
+      {
+        std::lock_guard<std::mutex> lck(m_queues[worker]->mutex);
+        auto& tasks = m_queues[worker]->tasks;
+        if (tasks.empty())
+          return false;
+        t = std::move(tasks.back());
+        tasks.pop_back();
+        --m_queued;
+        return true;
+      }
+
+      // a thief takes the oldest directory of another worker (closest to the root: the largest sub-tree)
+      bool steal(const std::size_t worker, task& t)
+      {
+        for (std::size_t i = 1; i < m_queues.size(); ++i)
+        {
+          auto& queue = *m_queues[(worker + i) % m_queues.size()];
+          std::lock_guard<std::mutex> lck(queue.mutex);
+          if (queue.tasks.empty())
+            continue;
+          t = std::move(queue.tasks.front());
+          queue.tasks.pop_front();
+          --m_queued;
+          return true;
+        }
+        return false;
+      }
+
+      void work(const std::size_t worker)
+      {
+        const walk_visitor visit = [&](const std::filesystem::path& p, const bool is_dir, const int depth) -> bool {
+          return m_visit(p, is_dir, depth, worker);
+        };
+
+        // bounded frontier: when too many directories are waiting, the sub-directory is walked in place
+        walk_descend descend = [&](dir_handle&& handle, const std::filesystem::path& dir, const int depth) {
+          if (m_queued < m_max_pending)
+            push(worker, task{ std::move(handle), dir, depth });
+          else
+            list_dir(handle, dir, depth, visit, descend, m_stop);
+        };
+
+        while (true)
+        {
+          task t;
+          if (!pop(worker, t) && !steal(worker, t))
+          {
+            std::unique_lock<std::mutex> lck(m_mutex);
+            m_wakeup.wait(lck, [this]() { return m_queued > 0 || m_pending == 0; });
+            if (m_pending == 0)
+              return;
+            continue;
+          }
+
+          try
+          {
+            if (!m_stop)
+              list_dir(t.handle, t.dir, t.depth, visit, descend, m_stop);
+          }
+          catch (...)
+          {
+            std::lock_guard<std::mutex> lck(m_mutex);
+            if (!m_error)
+              m_error = std::current_exception();
+            m_stop = true;
+          }
+
+          if (--m_pending == 0)
+          {
+            std::lock_guard<std::mutex> lck(m_mutex);
+            m_wakeup.notify_all();
+          }
+        }
+      }
+
+    private:
+      parallel_visitor m_visit;
+      std::size_t m_max_pending;
+      std::vector<std::unique_ptr<worker_queue>> m_queues;
+      std::atomic<std::size_t> m_queued;
+      std::atomic<std::size_t> m_pending;
+      std::atomic<bool> m_stop;
+      std::mutex m_mutex;
+      std::condition_variable m_wakeup;
+      std::exception_ptr m_error;
+    };
+
+    // number of threads of a parallel walk
+    inline std::size_t walk_threads(const parallel_options& options)
+    {
+      return options.threads ? options.threads : std::max(1u, std::thread::hardware_concurrency());
+    }
+
+    // concatenate the results of the workers
+    inline std::vector<std::filesystem::path> merge_results(std::vector<std::vector<std::filesystem::path>>& results,
+                                                            const bool sorted)
+    {
+      std::vector<std::filesystem::path> paths;
+      std::size_t count = 0;
+      for (const auto& r : results)
+        count += r.size();
+      paths.reserve(count);
+      for (auto& r : results)
+        std::move(r.begin(), r.end(), std::back_inserter(paths));
+      if (sorted)
+        std::sort(paths.begin(), paths.end());
+      return paths;
     }
-    return dirs;
   }
 
   // convert a path to a lowercase std::string
@@ -55,28 +495,491 @@ namespace files
     return str;
   }
 
-  // get all directories and sub-directories with filtering (using a std::regex, fullpath for skip_dirs)
-  inline const std::vector<std::filesystem::path> get_dirs(const std::filesystem::path& path,
-                                                           const int depth = infinite_depth,
-                                                           const std::regex& dir_regex = all_dirs,
-                                                           const std::vector<std::filesystem::path>& skip_dirs = {})
+  // case-insensitive matcher of a set of sub-strings (aho-corasick automaton compiled once):
+  // a path matches if it contains one of the patterns, it is tested in one pass without allocation
+  // (utf-8 bytes: the wide paths of windows are encoded on the fly)
+  class skip_matcher final
+  {
+  public:
+    explicit skip_matcher(const std::vector<std::filesystem::path>& patterns = {}) :
+      m_always(false),
+      m_classes(1),
+      m_class(),
+      m_next(),
+      m_terminal()
+    {
+      std::vector<std::string> strs;
+      for (const auto& p : patterns)
+      {
+        std::string str = p.u8string();
+        std::transform(str.cbegin(), str.cend(), str.begin(), [](const char& c) { return std::tolower(c); });
+        m_always |= str.empty();
+        strs.push_back(std::move(str));
+      }
+      if (strs.empty() || m_always)
+        return;
+
+      // bytes are folded to lowercase and mapped to the classes of the characters used by the patterns
+      std::array<int, 256> ids = {};
+      for (const auto& str : strs)
+        for (const unsigned char c : str)
+          if (!ids[c])
+            ids[c] = static_cast<int>(m_classes++);
+      for (int b = 0; b < 256; ++b)
+        m_class[b] = static_cast<uint8_t>(ids[std::tolower(b)]);
+
+      // trie of the patterns
+      m_next.assign(m_classes, -1);
+      m_terminal.assign(1, false);
+      for (const auto& str : strs)
+      {
+        std::size_t node = 0;
+        for (const unsigned char c : str)
+        {
+          int& child = m_next[node * m_classes + ids[c]];
+          if (child < 0)
+          {
+            child = static_cast<int>(m_terminal.size());
+            m_next.resize(m_next.size() + m_classes, -1);
+            m_terminal.push_back(false);
+          }
+          node = static_cast<std::size_t>(m_next[node * m_classes + ids[c]]);
+        }
+        m_terminal[node] = true;
+      }
+
+      // breadth-first: the failure transitions become direct transitions (complete automaton)
+      std::vector<std::size_t> fail(m_terminal.size(), 0);
+      std::deque<std::size_t> queue;
+      for (std::size_t c = 0; c < m_classes; ++c)
+      {
+        int& child = m_next[c];
+        if (child < 0)
+          child = 0;
+        else
+          queue.push_back(static_cast<std::size_t>(child));
+      }
+      while (!queue.empty())
+      {
+        const std::size_t node = queue.front();
+        queue.pop_front();
+        m_terminal[node] = m_terminal[node] || m_terminal[fail[node]];
+        for (std::size_t c = 0; c < m_classes; ++c)
+        {
+          int& child = m_next[node * m_classes + c];
+          const int fallback = m_next[fail[node] * m_classes + c];
+          if (child < 0)
+            child = fallback;
+          else
+          {
+            fail[static_cast<std::size_t>(child)] = static_cast<std::size_t>(fallback);
+            queue.push_back(static_cast<std::size_t>(child));
+          }
+        }
+      }
+    }
+
+    // true if there is no pattern
+    bool empty() const
+    {
+      return !m_always && m_terminal.empty();
+    }
+
+    // true if the utf-8 string contains one of the patterns (case-insensitive)
+    bool matches(const std::string_view str) const
+    {
+      return run(str.data(), str.data() + str.size());
+    }
+
+    // true if the path contains one of the patterns (case-insensitive)
+    bool matches(const std::filesystem::path& path) const
+    {
+      const auto& native = path.native();
+      return run(native.data(), native.data() + native.size());
+    }
+
+  private:
+    template <typename Char>
+    bool run(const Char* begin, const Char* end) const
+    {
+      if (m_always)
+        return true;
+      if (m_terminal.empty())
+        return false;
+      std::size_t node = 0;
+      return !details::utf8_bytes(begin, end, [&](const unsigned char c) -> bool {
+        node = static_cast<std::size_t>(m_next[node * m_classes + m_class[c]]);
+        return !m_terminal[node];
+      });
+    }
+
+  private:
+    bool m_always;
+    std::size_t m_classes;
+    std::array<uint8_t, 256> m_class;
+    std::vector<int> m_next;
+    std::vector<bool> m_terminal;
+  };
+
+  // get the identity of a file (symbolic links are followed), returns false if it doesn't exist
+  inline bool get_file_id(const std::filesystem::path& path, file_id& id)
   {
-    const auto& filter = [=](const std::filesystem::path& p1) -> bool {
-      const auto& compare_path = [p1](const std::filesystem::path& p2) -> bool {
-        return to_str(p1).find(to_str(p2)) != std::string::npos;
+#if defined(_WIN32)
+    const HANDLE file = CreateFileW(path.c_str(), 0, FILE_SHARE_READ | FILE_SHARE_WRITE | FILE_SHARE_DELETE, nullptr,
+                                    OPEN_EXISTING, FILE_FLAG_BACKUP_SEMANTICS, nullptr);
+    if (file == INVALID_HANDLE_VALUE)
+      return false;
+    BY_HANDLE_FILE_INFORMATION info;
+    const bool ok = GetFileInformationByHandle(file, &info) != 0;
+    CloseHandle(file);
+    if (!ok)
+      return false;
+    id = { info.dwVolumeSerialNumber, (static_cast<uint64_t>(info.nFileIndexHigh) << 32) | info.nFileIndexLow };
+#else
+    struct stat st;
+    if (::stat(path.c_str(), &st) != 0)
+      return false;
+    id = { static_cast<uint64_t>(st.st_dev), static_cast<uint64_t>(st.st_ino) };
+#endif
+    return true;
+  }
+
+  // set of files compared by identity, as std::filesystem::equivalent (hard links and links to a file match it):
+  // the identities are resolved once and the entries of a walk are tested with the metadata of the listing
+  class file_id_set final
+  {
+  public:
+    explicit file_id_set(const std::vector<std::filesystem::path>& files = {}) :
+      m_ids()
+    {
+      file_id id;
+      for (const auto& file : files)
+        if (get_file_id(file, id))
+          m_ids.insert(id);
+    }
+
+    bool empty() const
+    {
+      return m_ids.empty();
+    }
+
+    // true if the path is one of the files of the set
+    bool contains(const std::filesystem::path& path) const
+    {
+      if (m_ids.empty())
+        return false;
+      const details::walk_entry& entry = details::current_entry;
+      file_id id;
+      if (entry.path == &path)
+        id = entry.id;
+      else if (!get_file_id(path, id))
+        return false;
+      return m_ids.count(id) != 0;
+    }
+
+  private:
+    std::unordered_set<file_id, file_id_hash> m_ids;
+  };
+
+  namespace details
+  {
+    // directory filter of the std::regex overloads (fullpath for skip_dirs)
+    inline const std::function<bool(const std::filesystem::path&)> make_dir_filter(const std::regex& dir_regex,
+                                                                                   const std::vector<std::filesystem::path>& skip_dirs)
+    {
+      const std::shared_ptr<const skip_matcher> skip = std::make_shared<const skip_matcher>(skip_dirs);
+      return [=](const std::filesystem::path& p) -> bool {
+        return std::regex_search(p.string(), dir_regex) && !skip->matches(p);
       };
-      return std::regex_search(p1.string(), dir_regex) &&
-             std::find_if(skip_dirs.cbegin(), skip_dirs.cend(), compare_path) == skip_dirs.cend();
+    }
+
+    // directory filter of the files::pattern overloads (fullpath for skip_dirs)
+    inline const std::function<bool(const std::filesystem::path&)> make_dir_filter(const pattern& dir_pattern,
+                                                                                   const std::vector<std::filesystem::path>& skip_dirs)
+    {
+      const std::shared_ptr<const pattern> match = std::make_shared<const pattern>(dir_pattern);
+      const std::shared_ptr<const skip_matcher> skip = std::make_shared<const skip_matcher>(skip_dirs);
+      return [=](const std::filesystem::path& p) -> bool {
+        return match->matches(p) && !skip->matches(p);
+      };
+    }
+
+    // file filter of the std::regex overloads (filename with extension)
+    inline const std::function<bool(const std::filesystem::path&)> make_file_filter(const std::regex& file_regex,
+                                                                                    const std::vector<std::filesystem::path>& skip_files)
+    {
+      const std::shared_ptr<const file_id_set> skip = std::make_shared<const file_id_set>(skip_files);
+      return [=](const std::filesystem::path& p) -> bool {
+        return std::regex_search(p.filename().string(), file_regex) && !skip->contains(p);
+      };
+    }
+
+    // file filter of the files::pattern overloads (filename with extension)
+    inline const std::function<bool(const std::filesystem::path&)> make_file_filter(const pattern& file_pattern,
+                                                                                    const std::vector<std::filesystem::path>& skip_files)
+    {
+      const std::shared_ptr<const pattern> match = std::make_shared<const pattern>(file_pattern);
+      const std::shared_ptr<const file_id_set> skip = std::make_shared<const file_id_set>(skip_files);
+      return [=](const std::filesystem::path& p) -> bool {
+        return match->matches_filename(p) && !skip->contains(p);
+      };
+    }
+
+    // directories to descend into for the std::regex and files::pattern overloads: the sub-directories of a directory
+    // containing one of the skip_dirs contain it too, the directories rejected by the filter are only pruned on request
+    inline const std::function<bool(const std::filesystem::path&)> make_descend_filter(const std::function<bool(const std::filesystem::path&)>& dir_filter,
+                                                                                       const std::vector<std::filesystem::path>& skip_dirs,
+                                                                                       const bool prune_dirs)
+    {
+      if (prune_dirs)
+        return dir_filter;
+      if (skip_dirs.empty())
+        return nullptr;
+      const std::shared_ptr<const skip_matcher> skip = std::make_shared<const skip_matcher>(skip_dirs);
+      return [=](const std::filesystem::path& p) -> bool {
+        return !skip->matches(p);
+      };
+    }
+
+    // descend into a directory found at depth d: never beyond the maximum depth, only if accepted by the descend filter
+    inline bool check_descend(const int max_depth,
+                              const int current_depth,
+                              const std::function<bool(const std::filesystem::path&)>& descend_filter,
+                              const std::filesystem::path& p)
+    {
+      return (max_depth == infinite_depth || current_depth < max_depth) && (!descend_filter || descend_filter(p));
+    }
+
+    // walk of files::for_each_dir, stops as soon as stop is set (by the callback returning false or by another thread)
+    inline bool walk_dirs(const std::filesystem::path& path,
+                          const std::function<bool(const std::filesystem::path&)>& callback,
+                          const int depth,
+                          const std::function<bool(const std::filesystem::path&)>& dir_filter,
+                          const std::function<bool(const std::filesystem::path&)>& descend_filter,
+                          std::atomic<bool>& stop)
+    {
+      const auto& check_depth = [](const int max_depth, const int current_depth) -> bool {
+        return (max_depth == infinite_depth) ? true : (current_depth <= max_depth);
+      };
+      const auto& check_dir = [=](const std::filesystem::path& p, const int d) -> bool {
+        return check_depth(depth, d) && dir_filter(p);
+      };
+
+      if (!std::filesystem::is_directory(path))
+        throw std::runtime_error(fmt::format("invalid directory: \"{}\"", path.u8string()));
+
+      if (check_dir(path, 0) && !callback(path))
+        return false;
+      walk(path, [&](const std::filesystem::path& p, const bool is_dir, const int d) -> bool {
+        if (is_dir && check_dir(p, d) && !callback(p))
+          stop = true;
+        return is_dir && check_descend(depth, d, descend_filter, p);
+      }, stop);
+      return !stop;
+    }
+
+    // walk of files::for_each_file, stops as soon as stop is set (by the callback returning false or by another thread)
+    inline bool walk_files(const std::filesystem::path& path,
+                           const std::function<bool(const std::filesystem::path&)>& callback,
+                           const int depth,
+                           const bool include_dirs,
+                           const std::function<bool(const std::filesystem::path&)>& dir_filter,
+                           const std::function<bool(const std::filesystem::path&)>& file_filter,
+                           const std::function<bool(const std::filesystem::path&)>& descend_filter,
+                           std::atomic<bool>& stop)
+    {
+      const auto& check_depth = [](const int max_depth, const int current_depth) -> bool {
+        return (max_depth == infinite_depth) ? true : (current_depth <= max_depth);
+      };
+      const auto& check_dir = [=](const std::filesystem::path& p, const int d) -> bool {
+        return include_dirs ? check_depth(depth, d) && dir_filter(p) : false;
+      };
+      const auto& check_file = [=](const std::filesystem::path& p, const int d) -> bool {
+        return check_depth(depth, d) && dir_filter(p) && file_filter(p);
+      };
+
+      if (!std::filesystem::is_directory(path))
+        throw std::runtime_error(fmt::format("invalid directory: \"{}\"", path.u8string()));
+
+      walk(path, [&](const std::filesystem::path& p, const bool is_dir, const int d) -> bool {
+        if ((is_dir ? check_dir(p, d) : check_file(p, d)) && !callback(p))
+          stop = true;
+        return is_dir && check_descend(depth, d, descend_filter, p);
+      }, stop);
+      return !stop;
+    }
+  }
+
+  // call a function on each directory found as soon as it is found (using a std::function for filtering)
+  // the walk stops when the function returns false, returns false if the walk has been stopped
+  // the sub-directories of a directory rejected by descend_filter are never read (default: read all)
+  inline bool for_each_dir(const std::filesystem::path& path,
+                           const std::function<bool(const std::filesystem::path&)>& callback,
+                           const int depth,
+                           const std::function<bool(const std::filesystem::path&)>& dir_filter,
+                           const std::function<bool(const std::filesystem::path&)>& descend_filter = nullptr)
+  {
+    std::atomic<bool> stop(false);
+    return details::walk_dirs(path, callback, depth, dir_filter, descend_filter, stop);
+  }
+
+  // call a function on each directory found as soon as it is found (using a std::regex for filtering, fullpath for skip_dirs)
+  inline bool for_each_dir(const std::filesystem::path& path,
+                           const std::function<bool(const std::filesystem::path&)>& callback,
+                           const int depth = infinite_depth,
+                           const std::regex& dir_regex = all_dirs,
+                           const std::vector<std::filesystem::path>& skip_dirs = {},
+                           const bool prune_dirs = false)
+  {
+    const auto& dir_filter = details::make_dir_filter(dir_regex, skip_dirs);
+    return for_each_dir(path, callback, depth, dir_filter, details::make_descend_filter(dir_filter, skip_dirs, prune_dirs));
+  }
+
+  // get all directories and sub-directories with filtering (using a std::function)
+  inline std::vector<std::filesystem::path> get_dirs(const std::filesystem::path& path,
+                                                     const int depth,
+                                                     const std::function<bool(const std::filesystem::path&)>& dir_filter,
+                                                     const std::function<bool(const std::filesystem::path&)>& descend_filter = nullptr)
+  {
+    std::vector<std::filesystem::path> dirs;
+    for_each_dir(path, [&](const std::filesystem::path& p) -> bool {
+      dirs.push_back(p);
+      return true;
+    }, depth, dir_filter, descend_filter);
+    return dirs;
+  }
+
+  // get all directories and sub-directories with filtering in parallel (using a std::function called concurrently)
+  inline std::vector<std::filesystem::path> get_dirs(const std::filesystem::path& path,
+                                                     const int depth,
+                                                     const std::function<bool(const std::filesystem::path&)>& dir_filter,
+                                                     const parallel_options& options,
+                                                     const std::function<bool(const std::filesystem::path&)>& descend_filter = nullptr)
+  {
+    const auto& check_depth = [](const int max_depth, const int current_depth) -> bool {
+      return (max_depth == infinite_depth) ? true : (current_depth <= max_depth);
     };
-    return get_dirs(path, depth, filter);
+    const auto& check_dir = [=](const std::filesystem::path& p, const int d) -> bool {
+      return check_depth(depth, d) && dir_filter(p);
+    };
+
+    if (!std::filesystem::is_directory(path))
+      throw std::runtime_error(fmt::format("invalid directory: \"{}\"", path.u8string()));
+
+    const std::size_t threads = details::walk_threads(options);
+    std::vector<std::vector<std::filesystem::path>> dirs(threads);
+    if (check_dir(path, 0))
+      dirs[0].push_back(path);
+    details::parallel_walker walker(threads, options.max_pending, [&](const std::filesystem::path& p, const bool is_dir, const int d, const std::size_t worker) -> bool {
+      if (is_dir && check_dir(p, d))
+        dirs[worker].push_back(p);
+      return is_dir && details::check_descend(depth, d, descend_filter, p);
+    });
+    walker.run(path);
+    return details::merge_results(dirs, options.sorted);
+  }
+
+  // get all directories and sub-directories with filtering (using a std::regex, fullpath for skip_dirs)
+  inline std::vector<std::filesystem::path> get_dirs(const std::filesystem::path& path,
+                                                     const int depth = infinite_depth,
+                                                     const std::regex& dir_regex = all_dirs,
+                                                     const std::vector<std::filesystem::path>& skip_dirs = {},
+                                                     const bool prune_dirs = false)
+  {
+    const auto& dir_filter = details::make_dir_filter(dir_regex, skip_dirs);
+    return get_dirs(path, depth, dir_filter, details::make_descend_filter(dir_filter, skip_dirs, prune_dirs));
+  }
+
+  // get all directories and sub-directories with filtering in parallel (using a std::regex, fullpath for skip_dirs)
+  inline std::vector<std::filesystem::path> get_dirs(const std::filesystem::path& path,
+                                                     const int depth,
+                                                     const std::regex& dir_regex,
+                                                     const std::vector<std::filesystem::path>& skip_dirs,
+                                                     const parallel_options& options,
+                                                     const bool prune_dirs = false)
+  {
+    const auto& dir_filter = details::make_dir_filter(dir_regex, skip_dirs);
+    return get_dirs(path, depth, dir_filter, options, details::make_descend_filter(dir_filter, skip_dirs, prune_dirs));
+  }
+
+  // get all directories and sub-directories with filtering (using a compiled files::pattern, fullpath for dir and skip_dirs)
+  inline std::vector<std::filesystem::path> get_dirs(const std::filesystem::path& path,
+                                                     const int depth,
+                                                     const pattern& dir_pattern,
+                                                     const std::vector<std::filesystem::path>& skip_dirs = {},
+                                                     const bool prune_dirs = false)
+  {
+    const auto& dir_filter = details::make_dir_filter(dir_pattern, skip_dirs);
+    return get_dirs(path, depth, dir_filter, details::make_descend_filter(dir_filter, skip_dirs, prune_dirs));
+  }
+
+  // get all directories and sub-directories with filtering in parallel (using a compiled files::pattern, fullpath for dir and skip_dirs)
+  inline std::vector<std::filesystem::path> get_dirs(const std::filesystem::path& path,
+                                                     const int depth,
+                                                     const pattern& dir_pattern,
+                                                     const std::vector<std::filesystem::path>& skip_dirs,
+                                                     const parallel_options& options,
+                                                     const bool prune_dirs = false)
+  {
+    const auto& dir_filter = details::make_dir_filter(dir_pattern, skip_dirs);
+    return get_dirs(path, depth, dir_filter, options, details::make_descend_filter(dir_filter, skip_dirs, prune_dirs));
+  }
+
+  // call a function on each file found as soon as it is found (using a std::function for filtering)
+  // the walk stops when the function returns false, returns false if the walk has been stopped
+  // the content of a directory rejected by descend_filter is never read (default: read all)
+  inline bool for_each_file(const std::filesystem::path& path,
+                            const std::function<bool(const std::filesystem::path&)>& callback,
+                            const int depth,
+                            const bool include_dirs,
+                            const std::function<bool(const std::filesystem::path&)>& dir_filter,
+                            const std::function<bool(const std::filesystem::path&)>& file_filter,
+                            const std::function<bool(const std::filesystem::path&)>& descend_filter = nullptr)
+  {
+    std::atomic<bool> stop(false);
+    return details::walk_files(path, callback, depth, include_dirs, dir_filter, file_filter, descend_filter, stop);
+  }
+
+  // call a function on each file found as soon as it is found (using a std::regex for filtering, fullpath for dir, filename with extension for file)
+  inline bool for_each_file(const std::filesystem::path& path,
+                            const std::function<bool(const std::filesystem::path&)>& callback,
+                            const int depth = infinite_depth,
+                            const bool include_dirs = false,
+                            const std::regex& dir_regex = all_dirs,
+                            const std::regex& file_regex = all_files,
+                            const std::vector<std::filesystem::path>& skip_dirs = {},
+                            const std::vector<std::filesystem::path>& skip_files = {},
+                            const bool prune_dirs = false)
+  {
+    const auto& dir_filter = details::make_dir_filter(dir_regex, skip_dirs);
+    return for_each_file(path, callback, depth, include_dirs, dir_filter, details::make_file_filter(file_regex, skip_files),
+                         details::make_descend_filter(dir_filter, skip_dirs, prune_dirs));
   }
 
   // get all files on a directory and its sub-directories with filtering (using a std::function)
-  inline const std::vector<std::filesystem::path> get_files(const std::filesystem::path& path,
-                                                            const int depth,
-                                                            const bool include_dirs,
-                                                            const std::function<bool(const std::filesystem::path&)>& dir_filter,
-                                                            const std::function<bool(const std::filesystem::path&)>& file_filter)
+  inline std::vector<std::filesystem::path> get_files(const std::filesystem::path& path,
+                                                      const int depth,
+                                                      const bool include_dirs,
+                                                      const std::function<bool(const std::filesystem::path&)>& dir_filter,
+                                                      const std::function<bool(const std::filesystem::path&)>& file_filter,
+                                                      const std::function<bool(const std::filesystem::path&)>& descend_filter = nullptr)
+  {
+    std::vector<std::filesystem::path> files;
+    for_each_file(path, [&](const std::filesystem::path& p) -> bool {
+      files.push_back(p);
+      return true;
+    }, depth, include_dirs, dir_filter, file_filter, descend_filter);
+    return files;
+  }
+
+  // get all files on a directory and its sub-directories with filtering in parallel (using a std::function called concurrently)
+  inline std::vector<std::filesystem::path> get_files(const std::filesystem::path& path,
+                                                      const int depth,
+                                                      const bool include_dirs,
+                                                      const std::function<bool(const std::filesystem::path&)>& dir_filter,
+                                                      const std::function<bool(const std::filesystem::path&)>& file_filter,
+                                                      const parallel_options& options,
+                                                      const std::function<bool(const std::filesystem::path&)>& descend_filter = nullptr)
   {
     const auto& check_depth = [](const int max_depth, const int current_depth) -> bool {
       return (max_depth == infinite_depth) ? true : (current_depth <= max_depth);
@@ -87,72 +990,549 @@ namespace files
     const auto& check_file = [=](const std::filesystem::path& p, const int d) -> bool {
       return check_depth(depth, d) && dir_filter(p) && file_filter(p);
     };
-    const auto& check = [=](const std::filesystem::path& p, const int d) -> bool {
-      return std::filesystem::is_directory(p) ? check_dir(p, d) : check_file(p, d);
-    };
 
     if (!std::filesystem::is_directory(path))
       throw std::runtime_error(fmt::format("invalid directory: \"{}\"", path.u8string()));
 
-    std::vector<std::filesystem::path> files;
-    if (depth == 0)
+    const std::size_t threads = details::walk_threads(options);
+    std::vector<std::vector<std::filesystem::path>> files(threads);
+    details::parallel_walker walker(threads, options.max_pending, [&](const std::filesystem::path& p, const bool is_dir, const int d, const std::size_t worker) -> bool {
+      if (is_dir ? check_dir(p, d) : check_file(p, d))
+        files[worker].push_back(p);
+      return is_dir && details::check_descend(depth, d, descend_filter, p);
+    });
+    walker.run(path);
+    return details::merge_results(files, options.sorted);
+  }
+
+  // get all files on a directory and its sub-directories with filtering (using a std::regex, fullpath for dir, filename with extension for file)
+  inline std::vector<std::filesystem::path> get_files(const std::filesystem::path& path,
+                                                      const int depth = infinite_depth,
+                                                      const bool include_dirs = false,
+                                                      const std::regex& dir_regex = all_dirs,
+                                                      const std::regex& file_regex = all_files,
+                                                      const std::vector<std::filesystem::path>& skip_dirs = {},
+                                                      const std::vector<std::filesystem::path>& skip_files = {},
+                                                      const bool prune_dirs = false)
+  {
+    const auto& dir_filter = details::make_dir_filter(dir_regex, skip_dirs);
+    return get_files(path, depth, include_dirs, dir_filter, details::make_file_filter(file_regex, skip_files),
+                     details::make_descend_filter(dir_filter, skip_dirs, prune_dirs));
+  }
+
+  // get all files on a directory and its sub-directories with filtering in parallel (using a std::regex, fullpath for dir, filename with extension for file)
+  inline std::vector<std::filesystem::path> get_files(const std::filesystem::path& path,
+                                                      const int depth,
+                                                      const bool include_dirs,
+                                                      const std::regex& dir_regex,
+                                                      const std::regex& file_regex,
+                                                      const std::vector<std::filesystem::path>& skip_dirs,
+                                                      const std::vector<std::filesystem::path>& skip_files,
+                                                      const parallel_options& options,
+                                                      const bool prune_dirs = false)
+  {
+    const auto& dir_filter = details::make_dir_filter(dir_regex, skip_dirs);
+    return get_files(path, depth, include_dirs, dir_filter, details::make_file_filter(file_regex, skip_files), options,
+                     details::make_descend_filter(dir_filter, skip_dirs, prune_dirs));
+  }
+
+  // get all files on a directory and its sub-directories with filtering (using a compiled files::pattern, fullpath for dir, filename with extension for file)
+  inline std::vector<std::filesystem::path> get_files(const std::filesystem::path& path,
+                                                      const int depth,
+                                                      const bool include_dirs,
+                                                      const pattern& dir_pattern,
+                                                      const pattern& file_pattern,
+                                                      const std::vector<std::filesystem::path>& skip_dirs = {},
+                                                      const std::vector<std::filesystem::path>& skip_files = {},
+                                                      const bool prune_dirs = false)
+  {
+    const auto& dir_filter = details::make_dir_filter(dir_pattern, skip_dirs);
+    return get_files(path, depth, include_dirs, dir_filter, details::make_file_filter(file_pattern, skip_files),
+                     details::make_descend_filter(dir_filter, skip_dirs, prune_dirs));
+  }
+
+  // get all files on a directory and its sub-directories with filtering in parallel (using a compiled files::pattern, fullpath for dir, filename with extension for file)
+  inline std::vector<std::filesystem::path> get_files(const std::filesystem::path& path,
+                                                      const int depth,
+                                                      const bool include_dirs,
+                                                      const pattern& dir_pattern,
+                                                      const pattern& file_pattern,
+                                                      const std::vector<std::filesystem::path>& skip_dirs,
+                                                      const std::vector<std::filesystem::path>& skip_files,
+                                                      const parallel_options& options,
+                                                      const bool prune_dirs = false)
+  {
+    const auto& dir_filter = details::make_dir_filter(dir_pattern, skip_dirs);
+    return get_files(path, depth, include_dirs, dir_filter, details::make_file_filter(file_pattern, skip_files), options,
+                     details::make_descend_filter(dir_filter, skip_dirs, prune_dirs));
+  }
+
+  // default number of paths passed at once from the walking thread of a path_range
+  constexpr std::size_t default_range_batch = 1024;
+
+  // lazy range of the paths found by a walk: the walk runs in a background thread while the paths are
+  // consumed, only a few batches of paths are kept in memory and destroying the range stops the walk
+  //   for (const auto& p : files::scan_files(directory))
+  //     if (...) break;
+  class path_range final
+  {
+  public:
+    // walk calling the callback on each path found, stops when it returns false or as soon as stop is set
+    using walk_function = std::function<bool(const std::function<bool(const std::filesystem::path&)>& callback, std::atomic<bool>& stop)>;
+
+    class iterator
     {
-      for (const auto& entry : std::filesystem::directory_iterator(path))
+    public:
+      using iterator_category = std::input_iterator_tag;
+      using value_type = std::filesystem::path;
+      using difference_type = std::ptrdiff_t;
+      using pointer = const std::filesystem::path*;
+      using reference = const std::filesystem::path&;
+
+      explicit iterator(path_range* range = nullptr) :
+        m_range(range)
       {
-        if (check(entry.path(), 0))
-          files.push_back(entry.path());
+        if (m_range && !m_range->next())
+          m_range = nullptr;
       }
+
+      reference operator*() const { return m_range->current(); }
+      pointer operator->() const { return &m_range->current(); }
+
+      iterator& operator++()
+      {
+        if (!m_range->next())
+          m_range = nullptr;
+        return *this;
+      }
+
+      bool operator==(const iterator& other) const { return m_range == other.m_range; }
+      bool operator!=(const iterator& other) const { return m_range != other.m_range; }
+
+    private:
+      path_range* m_range;
+    };
+
+    path_range(const walk_function& walk,
+               const std::size_t batch_size = default_range_batch,
+               const std::size_t max_batches = 4) :
+      m_batch_size(std::max<std::size_t>(batch_size, 1)),
+      m_max_batches(std::max<std::size_t>(max_batches, 1)),
+      m_batches(),
+      m_current(),
+      m_index(0),
+      m_done(false),
+      m_stop(false),
+      m_waiting(false),
+      m_error(),
+      m_mutex(),
+      m_cond(),
+      m_thread()
+    {
+      m_thread = std::thread([this, walk]() { produce(walk); });
     }
-    else
+
+    path_range(const path_range&) = delete;
+    path_range& operator=(const path_range&) = delete;
+
+    ~path_range()
     {
-      auto entry = std::filesystem::recursive_directory_iterator(path);
-      while (entry != std::filesystem::recursive_directory_iterator())
       {
-        if (check(entry->path(), entry.depth()))
-          files.push_back(entry->path());
-        ++entry;
+        // the walk checks the flag on each entry: it ends without waiting for the next match
+        std::lock_guard<std::mutex> lck(m_mutex);
+        m_stop = true;
       }
+      m_cond.notify_all();
+      m_thread.join();
     }
-    return files;
-  }
 
-  // get all files on a directory and its sub-directories with filtering (using a std::regex, fullpath for dir, filename with extension for file)
-  inline const std::vector<std::filesystem::path> get_files(const std::filesystem::path& path,
-                                                            const int depth = infinite_depth,
-                                                            const bool include_dirs = false,
-                                                            const std::regex& dir_regex = all_dirs,
-                                                            const std::regex& file_regex = all_files,
-                                                            const std::vector<std::filesystem::path>& skip_dirs = {},
-                                                            const std::vector<std::filesystem::path>& skip_files = {})
-  {
-    const auto& dir_filter = [=](const std::filesystem::path& p1) -> bool {
-      const auto& compare_path = [p1](const std::filesystem::path& p2) -> bool {
-        return to_str(p1).find(to_str(p2)) != std::string::npos;
-      };
-      return std::regex_search(p1.string(), dir_regex) &&
-             std::find_if(skip_dirs.cbegin(), skip_dirs.cend(), compare_path) == skip_dirs.cend();
-    };
-    const auto& file_filter = [=](const std::filesystem::path& p1) -> bool {
-      const auto& compare_path = [p1](const std::filesystem::path& p2) -> bool {
-        return std::filesystem::equivalent(p1, p2);
+    // the range can only be iterated once
+    iterator begin() { return iterator(this); }
+    iterator end() { return iterator(); }
+
+  private:
+    // walking thread: the paths are sent by batches, it waits when the consumer is behind
+    void produce(const walk_function& walk)
+    {
+      std::vector<std::filesystem::path> batch;
+      const auto& send = [&]() -> bool {
+        std::unique_lock<std::mutex> lck(m_mutex);
+        m_cond.wait(lck, [this]() { return m_stop || m_batches.size() < m_max_batches; });
+        if (m_stop)
+          return false;
+        m_batches.push_back(std::move(batch));
+        batch.clear();
+        m_cond.notify_all();
+        return true;
       };
-      return std::regex_search(p1.filename().string(), file_regex) &&
-             std::find_if(skip_files.cbegin(), skip_files.cend(), compare_path) == skip_files.cend();
-    };
-    return get_files(path, depth, include_dirs, dir_filter, file_filter);
+
+      try
+      {
+        walk([&](const std::filesystem::path& p) -> bool {
+          if (m_stop)
+            return false;
+          batch.push_back(p);
+          // a partial batch is sent when the consumer is waiting for it (first path, sparse matches)
+          return (batch.size() < m_batch_size && !m_waiting) || send();
+        }, m_stop);
+        if (!batch.empty() && !m_stop)
+          send();
+      }
+      catch (...)
+      {
+        std::lock_guard<std::mutex> lck(m_mutex);
+        m_error = std::current_exception();
+      }
+
+      std::lock_guard<std::mutex> lck(m_mutex);
+      m_done = true;
+      m_cond.notify_all();
+    }
+
+    // move to the next path, returns false at the end of the walk
+    bool next()
+    {
+      if (++m_index < m_current.size())
+        return true;
+
+      std::unique_lock<std::mutex> lck(m_mutex);
+      m_waiting = m_batches.empty();
+      m_cond.wait(lck, [this]() { return m_done || !m_batches.empty(); });
+      m_waiting = false;
+      if (m_batches.empty())
+      {
+        if (m_error)
+          std::rethrow_exception(std::exchange(m_error, nullptr));
+        return false;
+      }
+      m_current = std::move(m_batches.front());
+      m_batches.pop_front();
+      m_index = 0;
+      m_cond.notify_all();
+      return true;
+    }
+
+    const std::filesystem::path& current() const
+    {
+      return m_current[m_index];
+    }
+
+  private:
+    std::size_t m_batch_size;
+    std::size_t m_max_batches;
+    std::deque<std::vector<std::filesystem::path>> m_batches;
+    std::vector<std::filesystem::path> m_current;
+    std::size_t m_index;
+    bool m_done;
+    std::atomic<bool> m_stop;
+    std::atomic<bool> m_waiting;
+    std::exception_ptr m_error;
+    std::mutex m_mutex;
+    std::condition_variable m_cond;
+    std::thread m_thread;
+  };
+
+  // lazy range of all directories and sub-directories with filtering (using a std::function)
+  inline path_range scan_dirs(const std::filesystem::path& path,
+                              const int depth,
+                              const std::function<bool(const std::filesystem::path&)>& dir_filter,
+                              const std::function<bool(const std::filesystem::path&)>& descend_filter = nullptr)
+  {
+    return path_range([=](const std::function<bool(const std::filesystem::path&)>& callback, std::atomic<bool>& stop) -> bool {
+      return details::walk_dirs(path, callback, depth, dir_filter, descend_filter, stop);
+    });
+  }
+
+  // lazy range of all directories and sub-directories with filtering (using a std::regex, fullpath for skip_dirs)
+  inline path_range scan_dirs(const std::filesystem::path& path,
+                              const int depth = infinite_depth,
+                              const std::regex& dir_regex = all_dirs,
+                              const std::vector<std::filesystem::path>& skip_dirs = {},
+                              const bool prune_dirs = false)
+  {
+    const auto& dir_filter = details::make_dir_filter(dir_regex, skip_dirs);
+    return scan_dirs(path, depth, dir_filter, details::make_descend_filter(dir_filter, skip_dirs, prune_dirs));
+  }
+
+  // lazy range of all files on a directory and its sub-directories with filtering (using a std::function)
+  inline path_range scan_files(const std::filesystem::path& path,
+                               const int depth,
+                               const bool include_dirs,
+                               const std::function<bool(const std::filesystem::path&)>& dir_filter,
+                               const std::function<bool(const std::filesystem::path&)>& file_filter,
+                               const std::function<bool(const std::filesystem::path&)>& descend_filter = nullptr)
+  {
+    return path_range([=](const std::function<bool(const std::filesystem::path&)>& callback, std::atomic<bool>& stop) -> bool {
+      return details::walk_files(path, callback, depth, include_dirs, dir_filter, file_filter, descend_filter, stop);
+    });
+  }
+
+  // lazy range of all files on a directory and its sub-directories with filtering (using a std::regex, fullpath for dir, filename with extension for file)
+  inline path_range scan_files(const std::filesystem::path& path,
+                               const int depth = infinite_depth,
+                               const bool include_dirs = false,
+                               const std::regex& dir_regex = all_dirs,
+                               const std::regex& file_regex = all_files,
+                               const std::vector<std::filesystem::path>& skip_dirs = {},
+                               const std::vector<std::filesystem::path>& skip_files = {},
+                               const bool prune_dirs = false)
+  {
+    const auto& dir_filter = details::make_dir_filter(dir_regex, skip_dirs);
+    return scan_files(path, depth, include_dirs, dir_filter, details::make_file_filter(file_regex, skip_files),
+                      details::make_descend_filter(dir_filter, skip_dirs, prune_dirs));
+  }
+
+  // access pattern of a mapped file, given to the system to tune the read-ahead
+  enum class map_access
+  {
+    normal,
+    sequential,
+    random
+  };
+
+  // options of files::read_view
+  struct map_options
+  {
+    map_access access = map_access::sequential;  // read-ahead hint
+    bool huge_pages = false;                      // ask for transparent huge pages (linux, when the file system supports them)
+    bool copy = true;                             // read into a buffer when the file can't be mapped (otherwise throw)
+  };
+
+  // read-only view of the content of a file: mapped in memory when possible (no allocation, no copy,
+  // the pages are read on first access), read into a buffer for the pipes and the special files
+  class file_view final
+  {
+    file_view(const file_view&) = delete;
+    file_view& operator=(const file_view&) = delete;
+
+  public:
+    file_view() = default;
+
+    explicit file_view(const std::filesystem::path& path, const map_options& options = map_options())
+    {
+#if defined(_WIN32)
+      const DWORD flags = options.access == map_access::sequential ? FILE_FLAG_SEQUENTIAL_SCAN :
+                          options.access == map_access::random ? FILE_FLAG_RANDOM_ACCESS : FILE_ATTRIBUTE_NORMAL;
+      m_file = CreateFileW(path.c_str(), GENERIC_READ, FILE_SHARE_READ, nullptr, OPEN_EXISTING, flags, nullptr);
+      if (m_file == INVALID_HANDLE_VALUE)
+        throw std::runtime_error(fmt::format("can't open file: \"{}\"", path.filename().u8string()));
+      LARGE_INTEGER size;
+      if (GetFileType(m_file) == FILE_TYPE_DISK && GetFileSizeEx(m_file, &size))
+      {
+        // file mappings can't use large pages on windows: huge_pages is ignored
+        m_size = static_cast<std::size_t>(size.QuadPart);
+        if (!m_size)
+          return;
+        m_mapping = CreateFileMappingW(m_file, nullptr, PAGE_READONLY, 0, 0, nullptr);
+        if (m_mapping)
+          m_data = static_cast<const char*>(MapViewOfFile(m_mapping, FILE_MAP_READ, 0, 0, 0));
+        m_mapped = m_data != nullptr;
+        if (m_mapped)
+          return;
+      }
+#elif defined(__linux__)
+      m_fd = ::open(path.c_str(), O_RDONLY | O_CLOEXEC);
+      if (m_fd < 0)
+        throw std::runtime_error(fmt::format("can't open file: \"{}\"", path.filename().u8string()));
+      struct stat st;
+      // the files of /proc and /sys have a size of 0: read like the special files
+      if (::fstat(m_fd, &st) == 0 && S_ISREG(st.st_mode) && st.st_size > 0)
+      {
+        m_size = static_cast<std::size_t>(st.st_size);
+        void* data = ::mmap(nullptr, m_size, PROT_READ, MAP_SHARED, m_fd, 0);
+        if (data != MAP_FAILED)
+        {
+          m_data = static_cast<const char*>(data);
+          m_mapped = true;
+          if (options.access != map_access::normal)
+            ::madvise(data, m_size, options.access == map_access::sequential ? MADV_SEQUENTIAL : MADV_RANDOM);
+#if defined(MADV_HUGEPAGE)
+          if (options.huge_pages)
+            ::madvise(data, m_size, MADV_HUGEPAGE);
+#endif
+          return;
+        }
+      }
+#endif
+      if (!options.copy)
+        throw std::runtime_error(fmt::format("can't map file: \"{}\"", path.filename().u8string()));
+      read_all(path);
+    }
+
+    file_view(file_view&& other) noexcept
+    {
+      swap(other);
+    }
+
+    file_view& operator=(file_view&& other) noexcept
+    {
+      swap(other);
+      return *this;
+    }
+
+    // destructor
+    ~file_view()
+    {
+      close();
+    }
+
+    const char* data() const
+    {
+      return m_data;
+    }
+
+    std::size_t size() const
+    {
+      return m_size;
+    }
+
+    bool empty() const
+    {
+      return m_size == 0;
+    }
+
+    // the content is mapped (otherwise it was read into a buffer)
+    bool mapped() const
+    {
+      return m_mapped;
+    }
+
+    std::string_view view() const
+    {
+      return std::string_view(m_data, m_size);
+    }
+
+    operator std::string_view() const
+    {
+      return view();
+    }
+
+  private:
+    // buffered read until the end of the stream: the size of a pipe or a special file isn't known
+    void read_all(const std::filesystem::path& path)
+    {
+#if defined(_WIN32) || defined(__linux__)
+      std::size_t len = 0;
+      m_buffer.resize(64 * 1024);
+      while (true)
+      {
+        if (len == m_buffer.size())
+          m_buffer.resize(m_buffer.size() * 2);
+#if defined(_WIN32)
+        DWORD n = 0;
+        const DWORD chunk = static_cast<DWORD>(std::min<std::size_t>(m_buffer.size() - len, 1u << 30));
+        if (!ReadFile(m_file, m_buffer.data() + len, chunk, &n, nullptr))
+        {
+          if (GetLastError() == ERROR_BROKEN_PIPE)
+            break;
+          throw std::runtime_error(fmt::format("can't read file: \"{}\"", path.filename().u8string()));
+        }
+#else
+        const ssize_t n = ::read(m_fd, m_buffer.data() + len, m_buffer.size() - len);
+        if (n < 0)
+        {
+          if (errno == EINTR)
+            continue;
+          throw std::runtime_error(fmt::format("can't read file: \"{}\"", path.filename().u8string()));
+        }
+#endif
+        if (n == 0)
+          break;
+        len += static_cast<std::size_t>(n);
+      }
+      m_buffer.resize(len);
+#else
+      std::ifstream file(path, std::ios::binary);
+      if (!file.good())
+        throw std::runtime_error(fmt::format("can't open file: \"{}\"", path.filename().u8string()));
+      m_buffer.assign(std::istreambuf_iterator<char>(file), std::istreambuf_iterator<char>());
+#endif
+      m_buffer.shrink_to_fit();
+      m_data = m_buffer.data();
+      m_size = m_buffer.size();
+    }
+
+    void swap(file_view& other) noexcept
+    {
+      std::swap(m_data, other.m_data);
+      std::swap(m_size, other.m_size);
+      std::swap(m_mapped, other.m_mapped);
+      std::swap(m_buffer, other.m_buffer);
+#if defined(_WIN32)
+      std::swap(m_file, other.m_file);
+      std::swap(m_mapping, other.m_mapping);
+#elif defined(__linux__)
+      std::swap(m_fd, other.m_fd);
+#endif
+    }
+
+    void close()
+    {
+#if defined(_WIN32)
+      if (mapped())
+        UnmapViewOfFile(m_data);
+      if (m_mapping)
+        CloseHandle(m_mapping);
+      if (m_file != INVALID_HANDLE_VALUE)
+        CloseHandle(m_file);
+      m_mapping = nullptr;
+      m_file = INVALID_HANDLE_VALUE;
+#elif defined(__linux__)
+      if (mapped())
+        ::munmap(const_cast<char*>(m_data), m_size);
+      if (m_fd >= 0)
+        ::close(m_fd);
+      m_fd = -1;
+#endif
+      m_data = nullptr;
+      m_size = 0;
+      m_mapped = false;
+    }
+
+  private:
+    const char* m_data = nullptr;
+    std::size_t m_size = 0;
+    bool m_mapped = false;
+    std::vector<char> m_buffer;
+#if defined(_WIN32)
+    HANDLE m_file = INVALID_HANDLE_VALUE;
+    HANDLE m_mapping = nullptr;
+#elif defined(__linux__)
+    int m_fd = -1;
+#endif
+  };
+
+  // get a read-only view of a file without copying it (mapped in memory, buffered for the pipes and the special files)
+  inline file_view read_view(const std::filesystem::path& path, const map_options& options = map_options())
+  {
+    return file_view(path, options);
   }
 
   // read file in one std::string
   inline const std::string read(const std::filesystem::path& path)
   {
-    std::ifstream file(path, std::ios::binary);
-    if (!file)
+    const hashpp::io::file file(path);
+    if (!file.valid())
       throw std::runtime_error(fmt::format("can't open file: \"{}\"", path.filename().u8string()));
-    file.seekg(0, std::ios::end);
-    const std::size_t size = file.tellg();
-    file.seekg(0, std::ios::beg);
+    const std::size_t size = static_cast<std::size_t>(file.size());
     std::string str(size, 0);
-    file.read(&str[0], size);
+
+    // only read the data extents: the holes of sparse files are already zero-filled
+    uint64_t start = 0;
+    uint64_t end = 0;
+    for (uint64_t offset = 0; offset < size && file.nextData(offset, start, end) && start < size; offset = end)
+    {
+      end = std::min<uint64_t>(end, size);
+      const std::size_t len = static_cast<std::size_t>(end - start);
+      const std::size_t n = file.readAt(start, reinterpret_cast<uint8_t*>(&str[start]), len);
+      if (n < len)
+      {
+        if (file.failed())
+          throw std::runtime_error(fmt::format("can't read file: \"{}\"", path.filename().u8string()));
+        str.resize(start + n);
+        break;
+      }
+    }
     return str;
   }
 
@@ -164,7 +1544,431 @@ namespace files
     std::ifstream f(file, std::ios::binary);
     if (!f.good())
       throw std::runtime_error(fmt::format("can't open file: \"{}\"", file.filename().u8string()));
-    return hashpp::get::getFileHash(algorithm, file.string()).getString();
+    const std::string hash = hashpp::get::getFileHash(algorithm, file.string()).getString();
+    if (hash.empty())
+      throw std::runtime_error(fmt::format("can't read file: \"{}\"", file.filename().u8string()));
+    return hash;
+  }
+
+  // get the hash of a file with progress notifications and cancellation:
+  // progress is called with the number of bytes hashed, every 'granularity' bytes
+  // returns an empty string if the hashing has been cancelled
+  inline const std::string get_hash(const std::filesystem::path& file,
+                                    const hashpp::ALGORITHMS& algorithm,
+                                    const std::function<void(uint64_t)>& progress,
+                                    const std::atomic<bool>* cancel = nullptr,
+                                    const uint64_t granularity = hashpp::io::defaultProgressGranularity)
+  {
+    // try to open file in binary mode
+    std::ifstream f(file, std::ios::binary);
+    if (!f.good())
+      throw std::runtime_error(fmt::format("can't open file: \"{}\"", file.filename().u8string()));
+    hashpp::io::fileOptions options;
+    options.progress = progress;
+    options.progressGranularity = granularity;
+    options.cancel = cancel;
+    const std::string hash = hashpp::get::getFileHash(algorithm, file.string(), options).getString();
+    if (hash.empty() && !(cancel && cancel->load(std::memory_order_relaxed)))
+      throw std::runtime_error(fmt::format("can't read file: \"{}\"", file.filename().u8string()));
+    return hash;
+  }
+
+  // get the fuzzy (ssdeep style) hash of a file: compare it with hashpp::fuzzy::compare
+  // to find near-duplicates (files differing only by a few bytes, like embedded timestamps)
+  inline const std::string get_fuzzy_hash(const std::filesystem::path& file)
+  {
+    // try to open file in binary mode
+    std::ifstream f(file, std::ios::binary);
+    if (!f.good())
+      throw std::runtime_error(fmt::format("can't open file: \"{}\"", file.filename().u8string()));
+    return hashpp::fuzzy::getFileHash(file).getString();
+  }
+
+  // default size of the chunks used by the chunked (merkle) hash of a file
+  constexpr std::size_t default_chunk_size = 1024 * 1024;
+
+  // chunked (merkle) hash of a file: one digest per fixed-size chunk combined pairwise up to a root digest
+  //   - levels[0] holds the digests of the chunks (hexadecimal hash of the chunk data)
+  //   - levels[n + 1][i] is the hash of "node:" + levels[n][2 * i] + levels[n][2 * i + 1] (a lone node is promoted)
+  //   - levels.back()[0] is the root digest
+  struct chunked_hash
+  {
+    hashpp::ALGORITHMS algorithm = hashpp::ALGORITHMS::SHA2_256;
+    std::size_t chunk_size = default_chunk_size;
+    uint64_t size = 0;
+    std::vector<std::vector<std::string>> levels;
+
+    const std::vector<std::string>& chunks() const { return levels.front(); }
+    const std::string& root() const { return levels.back().front(); }
+  };
+
+  namespace details
+  {
+    // hash the [offset, offset + length) range of an opened file (clipped to the end of the file)
+    // a short read inside the clipped range is an error (the file has been truncated meanwhile)
+    inline const std::string hash_range(const std::filesystem::path& file,
+                                        const hashpp::io::file& input,
+                                        hashpp::common& hasher,
+                                        const uint64_t offset,
+                                        const uint64_t length,
+                                        std::vector<uint8_t>& buf)
+    {
+      const uint64_t size = input.size();
+      const uint64_t begin = std::min(offset, size);
+      const uint64_t end = begin + std::min(length, size - begin);
+      hasher.init();
+      for (uint64_t pos = begin; pos < end;)
+      {
+        const std::size_t len = static_cast<std::size_t>(std::min<uint64_t>(buf.size(), end - pos));
+        const std::size_t n = input.readAt(pos, buf.data(), len);
+        if (n < len)
+          throw std::runtime_error(fmt::format("can't read file: \"{}\"", file.filename().u8string()));
+        hasher.update(buf.data(), n);
+        pos += n;
+      }
+      return hasher.finalize();
+    }
+
+    // recompute the tree nodes above the dirty chunks of a chunked hash
+    inline void update_tree(chunked_hash& hash, std::vector<bool> dirty)
+    {
+      std::size_t level = 0;
+      for (; hash.levels[level].size() > 1; ++level)
+      {
+        if (hash.levels.size() == level + 1)
+          hash.levels.emplace_back();
+        const std::vector<std::string>& nodes = hash.levels[level];
+        const std::size_t count = (nodes.size() + 1) / 2;
+        std::vector<std::string>& parents = hash.levels[level + 1];
+        const std::size_t previous_count = parents.size();
+        parents.resize(count);
+
+        // the last parent is always recomputed: its children may have changed with the size of the level
+        std::vector<bool> parents_dirty(count, false);
+        for (std::size_t i = 0; i < count; ++i)
+        {
+          const bool has_right = 2 * i + 1 < nodes.size();
+          if (!(i + 1 >= previous_count || dirty[2 * i] || (has_right && dirty[2 * i + 1])))
+            continue;
+          parents[i] = has_right ? hashpp::get::getHash(hash.algorithm, "node:" + nodes[2 * i] + nodes[2 * i + 1]).getString() : nodes[2 * i];
+          parents_dirty[i] = true;
+        }
+        dirty = std::move(parents_dirty);
+      }
+      hash.levels.resize(level + 1);
+    }
+
+    // hash the chunks of a file starting at chunk index 'first' (all the following chunks are rehashed)
+    inline void hash_chunks(const std::filesystem::path& file, chunked_hash& hash, const std::size_t first, std::vector<bool>& dirty)
+    {
+      const hashpp::io::file input(file);
+      if (!input.valid())
+        throw std::runtime_error(fmt::format("can't open file: \"{}\"", file.filename().u8string()));
+      hash.size = input.size();
+
+      const std::size_t count = std::max<std::size_t>(1, static_cast<std::size_t>((hash.size + hash.chunk_size - 1) / hash.chunk_size));
+      hash.levels.front().resize(count);
+      dirty.resize(count, true);
+
+      const std::unique_ptr<hashpp::common> hasher = hashpp::get::getHasher(hash.algorithm);
+      std::vector<uint8_t> buf(std::min<std::size_t>(hash.chunk_size, hashpp::io::defaultBufferSize));
+      for (std::size_t i = first; i < count; ++i)
+      {
+        hash.levels.front()[i] = hash_range(file, input, *hasher, static_cast<uint64_t>(i) * hash.chunk_size, hash.chunk_size, buf);
+        dirty[i] = true;
+      }
+    }
+  }
+
+  // get the chunked (merkle) hash of a file
+  inline const chunked_hash get_chunked_hash(const std::filesystem::path& file,
+                                             const hashpp::ALGORITHMS& algorithm = hashpp::ALGORITHMS::SHA2_256,
+                                             const std::size_t chunk_size = default_chunk_size)
+  {
+    if (!chunk_size)
+      throw std::runtime_error("invalid chunk size: 0");
+    chunked_hash hash;
+    hash.algorithm = algorithm;
+    hash.chunk_size = chunk_size;
+    hash.levels.resize(1);
+    std::vector<bool> dirty;
+    details::hash_chunks(file, hash, 0, dirty);
+    details::update_tree(hash, std::move(dirty));
+    return hash;
+  }
+
+  // update the chunked (merkle) hash of a file after an append or a modification:
+  //   - appended data (or truncation) is detected from the file size: the last known chunk and the new ones are rehashed
+  //   - modified: list of [offset, length) ranges written since the hash was computed, only their chunks are rehashed
+  inline void update_chunked_hash(const std::filesystem::path& file,
+                                  chunked_hash& hash,
+                                  const std::vector<std::pair<uint64_t, uint64_t>>& modified = {})
+  {
+    if (hash.levels.empty() || !hash.chunk_size)
+    {
+      hash = get_chunked_hash(file, hash.algorithm, hash.chunk_size ? hash.chunk_size : default_chunk_size);
+      return;
+    }
+
+    // rehash from the last chunk which was (or now is) partially filled
+    const uint64_t new_size = std::filesystem::file_size(file);
+    const std::size_t first = static_cast<std::size_t>(std::min(hash.size, new_size) / hash.chunk_size);
+    std::vector<bool> dirty(std::min(first, hash.levels.front().size()), false);
+    details::hash_chunks(file, hash, std::min(first, hash.levels.front().size()), dirty);
+
+    // rehash the modified chunks located before
+    if (!modified.empty())
+    {
+      for (const auto& [offset, length] : modified)
+      {
+        // ranges are clipped to the file: offset + length can't overflow
+        if (!length || offset >= new_size)
+          continue;
+        const uint64_t last = offset + std::min(length, new_size - offset) - 1;
+        const std::size_t begin = static_cast<std::size_t>(offset / hash.chunk_size);
+        const std::size_t end = static_cast<std::size_t>(std::min<uint64_t>(last / hash.chunk_size + 1, dirty.size()));
+        for (std::size_t i = begin; i < end; ++i)
+          dirty[i] = true;
+      }
+      const std::unique_ptr<hashpp::common> hasher = hashpp::get::getHasher(hash.algorithm);
+      const hashpp::io::file input(file);
+      if (!input.valid())
+        throw std::runtime_error(fmt::format("can't open file: \"{}\"", file.filename().u8string()));
+      std::vector<uint8_t> buf(std::min<std::size_t>(hash.chunk_size, hashpp::io::defaultBufferSize));
+      for (std::size_t i = 0; i < first && i < dirty.size(); ++i)
+      {
+        if (dirty[i])
+          hash.levels.front()[i] = details::hash_range(file, input, *hasher, static_cast<uint64_t>(i) * hash.chunk_size, hash.chunk_size, buf);
+      }
+    }
+    details::update_tree(hash, std::move(dirty));
+  }
+
+  // get the hash of the [offset, offset + length) byte range of a file (clipped to the end of the file)
+  inline const std::string get_range_hash(const std::filesystem::path& file,
+                                          const uint64_t offset,
+                                          const uint64_t length,
+                                          const hashpp::ALGORITHMS& algorithm = hashpp::ALGORITHMS::SHA2_256)
+  {
+    const hashpp::io::file input(file);
+    if (!input.valid())
+      throw std::runtime_error(fmt::format("can't open file: \"{}\"", file.filename().u8string()));
+    const std::unique_ptr<hashpp::common> hasher = hashpp::get::getHasher(algorithm);
+    std::vector<uint8_t> buf(static_cast<std::size_t>(std::min<uint64_t>(length, hashpp::io::defaultBufferSize)));
+    return details::hash_range(file, input, *hasher, offset, length, buf);
+  }
+
+  // default size of each sample used by the fingerprint of a file
+  constexpr std::size_t default_sample_size = 64 * 1024;
+
+  // get a quick fingerprint of a file: hash of its size and of the digests of its first, middle and last samples
+  // (cheap "probably unchanged" check, doesn't detect modifications outside of the samples)
+  inline const std::string get_fingerprint(const std::filesystem::path& file,
+                                           const std::size_t sample_size = default_sample_size,
+                                           const hashpp::ALGORITHMS& algorithm = hashpp::ALGORITHMS::SHA2_256)
+  {
+    const hashpp::io::file input(file);
+    if (!input.valid())
+      throw std::runtime_error(fmt::format("can't open file: \"{}\"", file.filename().u8string()));
+    const uint64_t size = input.size();
+    const uint64_t middle = size > sample_size ? (size - sample_size) / 2 : 0;
+    const uint64_t last = size > sample_size ? size - sample_size : 0;
+
+    const std::unique_ptr<hashpp::common> hasher = hashpp::get::getHasher(algorithm);
+    std::vector<uint8_t> buf(std::max<std::size_t>(1, std::min(sample_size, hashpp::io::defaultBufferSize)));
+    const std::string first_hash = details::hash_range(file, input, *hasher, 0, sample_size, buf);
+    const std::string middle_hash = details::hash_range(file, input, *hasher, middle, sample_size, buf);
+    const std::string last_hash = details::hash_range(file, input, *hasher, last, sample_size, buf);
+    return hashpp::get::getHash(algorithm, fmt::format("{}:{}:{}:{}", size, first_hash, middle_hash, last_hash)).getString();
+  }
+
+  // merkle hash of a directory tree: the digest of a directory is the hash of the sorted list of its
+  // entries (type, mode, name and digest), the digest of a file is the hash of its content
+  // (two trees are compared by their root, then only the mismatched sub-directories are compared)
+  // symbolic links are never followed: their digest is the hash of their target path
+  struct tree_hash
+  {
+    hashpp::ALGORITHMS algorithm = hashpp::ALGORITHMS::SHA2_256;
+    std::map<std::string, std::string> dirs;   // relative directory ("." for the root) -> digest of its subtree
+    std::map<std::string, std::string> files;  // relative file -> digest of its content
+    std::map<std::string, std::string> links;  // relative symbolic link -> digest of its target path
+
+    const std::string& root() const { return dirs.at("."); }
+  };
+
+  namespace details
+  {
+    // hash the files in parallel
+    inline const std::vector<std::string> hash_files(const std::vector<std::filesystem::path>& files,
+                                                     const hashpp::ALGORITHMS& algorithm)
+    {
+      std::vector<std::string> digests(files.size());
+      std::atomic<std::size_t> next(0);
+      std::exception_ptr error;
+      std::mutex error_mutex;
+      const auto& worker = [&]() {
+        try
+        {
+          const std::unique_ptr<hashpp::common> hasher = hashpp::get::getHasher(algorithm);
+          for (std::size_t i = next++; i < files.size(); i = next++)
+          {
+            if (!hashpp::io::file(files[i]).valid())
+              throw std::runtime_error(fmt::format("can't open file: \"{}\"", files[i].filename().u8string()));
+            digests[i] = hasher->getHash(files[i]);
+            if (digests[i].empty())
+              throw std::runtime_error(fmt::format("can't read file: \"{}\"", files[i].filename().u8string()));
+          }
+        }
+        catch (...)
+        {
+          std::lock_guard<std::mutex> lck(error_mutex);
+          if (!error)
+            error = std::current_exception();
+          next = files.size();
+        }
+      };
+
+      const std::size_t count = std::min<std::size_t>(std::max(1u, std::thread::hardware_concurrency()), files.size());
+      std::vector<std::thread> threads;
+      for (std::size_t i = 1; i < count; ++i)
+        threads.emplace_back(worker);
+      worker();
+      for (auto& t : threads)
+        t.join();
+      if (error)
+        std::rethrow_exception(error);
+      return digests;
+    }
+
+    // permissions of an entry (part of the digest of its parent)
+    inline unsigned get_mode(const std::filesystem::file_status& status)
+    {
+      return static_cast<unsigned>(status.permissions()) & 0777;
+    }
+
+    // compute the digests of the directories bottom-up from the list of entries (files and directories)
+    inline const tree_hash build_tree_hash(const std::filesystem::path& path,
+                                           const std::vector<std::filesystem::path>& entries,
+                                           const hashpp::ALGORITHMS& algorithm)
+    {
+      // relative names use '/' whatever the system: the digests are the same on every host
+      const auto& relative = [&](const std::filesystem::path& p) -> std::string {
+        const std::string rel = p.lexically_relative(path).generic_u8string();
+        return rel.empty() ? "." : rel;
+      };
+      const auto& parent_of = [](const std::string& rel) -> std::string {
+        const std::size_t pos = rel.rfind('/');
+        return pos == std::string::npos ? "." : rel.substr(0, pos);
+      };
+      const auto& name_of = [](const std::string& rel) -> std::string {
+        const std::size_t pos = rel.rfind('/');
+        return pos == std::string::npos ? rel : rel.substr(pos + 1);
+      };
+
+      // one symlink_status per entry (links are never followed, other entry types are ignored):
+      // parents of the selected entries are part of the tree even if they have been filtered out
+      std::vector<std::filesystem::path> files;
+      std::vector<unsigned> file_modes;
+      std::map<std::string, unsigned> dirs = { { ".", get_mode(std::filesystem::status(path)) } };
+      std::map<std::string, std::map<std::string, std::string>> children;
+      tree_hash hash;
+      hash.algorithm = algorithm;
+      const auto& add_dir = [&](std::string rel) {
+        while (rel != "." && dirs.find(rel) == dirs.end())
+        {
+          std::error_code ec;
+          dirs[rel] = get_mode(std::filesystem::symlink_status(path / std::filesystem::u8path(rel), ec));
+          rel = parent_of(rel);
+        }
+      };
+      for (const auto& entry : entries)
+      {
+        std::error_code ec;
+        const std::filesystem::file_status status = std::filesystem::symlink_status(entry, ec);
+        if (std::filesystem::is_directory(status))
+        {
+          const std::string rel = relative(entry);
+          if (rel != ".")
+          {
+            dirs[rel] = get_mode(status);
+            add_dir(parent_of(rel));
+          }
+        }
+        else if (std::filesystem::is_regular_file(status))
+        {
+          files.push_back(entry);
+          file_modes.push_back(get_mode(status));
+          add_dir(parent_of(relative(entry)));
+        }
+        else if (std::filesystem::is_symlink(status))
+        {
+          const std::filesystem::path target = std::filesystem::read_symlink(entry, ec);
+          if (ec)
+            throw std::runtime_error(fmt::format("can't read link: \"{}\"", entry.filename().u8string()));
+          const std::string rel = relative(entry);
+          const std::string name = name_of(rel);
+          const std::string digest = hashpp::get::getHash(algorithm, target.generic_u8string()).getString();
+          hash.links[rel] = digest;
+          children[parent_of(rel)][name] = fmt::format("link {:o} {}:{} {}\n", get_mode(status), name.size(), name, digest);
+          add_dir(parent_of(rel));
+        }
+      }
+
+      // entries of each directory, sorted by name
+      const std::vector<std::string> digests = hash_files(files, algorithm);
+      for (std::size_t i = 0; i < files.size(); ++i)
+      {
+        const std::string rel = relative(files[i]);
+        hash.files[rel] = digests[i];
+        const std::string name = name_of(rel);
+        children[parent_of(rel)][name] = fmt::format("file {:o} {}:{} {}\n", file_modes[i], name.size(), name, digests[i]);
+      }
+
+      // deepest directories first: a directory is hashed once all its sub-directories are
+      std::vector<std::string> order;
+      for (const auto& dir : dirs)
+        order.push_back(dir.first);
+      std::stable_sort(order.begin(), order.end(), [](const std::string& a, const std::string& b) {
+        const auto& depth = [](const std::string& s) { return s == "." ? 0 : std::count(s.cbegin(), s.cend(), '/') + 1; };
+        return depth(a) > depth(b);
+      });
+      for (const auto& rel : order)
+      {
+        std::string content = "tree\n";
+        for (const auto& child : children[rel])
+          content += child.second;
+        const std::string digest = hashpp::get::getHash(algorithm, content).getString();
+        hash.dirs[rel] = digest;
+        if (rel != ".")
+        {
+          const std::string name = name_of(rel);
+          children[parent_of(rel)][name] = fmt::format("dir {:o} {}:{} {}\n", dirs[rel], name.size(), name, digest);
+        }
+      }
+      return hash;
+    }
+  }
+
+  // get the merkle hash of a directory tree with filtering (using a std::function), the files are hashed in parallel
+  inline const tree_hash get_tree_hash(const std::filesystem::path& path,
+                                       const hashpp::ALGORITHMS& algorithm,
+                                       const int depth,
+                                       const std::function<bool(const std::filesystem::path&)>& dir_filter,
+                                       const std::function<bool(const std::filesystem::path&)>& file_filter)
+  {
+    return details::build_tree_hash(path, get_files(path, depth, true, dir_filter, file_filter), algorithm);
+  }
+
+  // get the merkle hash of a directory tree with filtering (using a std::regex, fullpath for dir, filename with extension for file)
+  inline const tree_hash get_tree_hash(const std::filesystem::path& path,
+                                       const hashpp::ALGORITHMS& algorithm = hashpp::ALGORITHMS::SHA2_256,
+                                       const int depth = infinite_depth,
+                                       const std::regex& dir_regex = all_dirs,
+                                       const std::regex& file_regex = all_files,
+                                       const std::vector<std::filesystem::path>& skip_dirs = {},
+                                       const std::vector<std::filesystem::path>& skip_files = {})
+  {
+    return details::build_tree_hash(path, get_files(path, depth, true, dir_regex, file_regex, skip_dirs, skip_files), algorithm);
   }
 
   // get stat from file
@@ -178,10 +1982,11 @@ namespace files
 
   // set ctime/mtime for file
   inline const void set_stat(const std::filesystem::path& file,
-                             const uint64_t ctime,
+                             [[maybe_unused]] const uint64_t ctime,
                              const uint64_t atime,
                              const uint64_t mtime)
   {
+#if defined(_WIN32)
     HANDLE fp = CreateFileA(file.string().c_str(),
                             GENERIC_WRITE,
                             FILE_SHARE_WRITE,
@@ -212,5 +2017,15 @@ namespace files
       }
       CloseHandle(fp);
     }
+#else
+    // the change time can't be set: only atime and mtime, 0 keeps the current value
+    struct timespec times[2];
+    times[0].tv_sec = static_cast<time_t>(atime);
+    times[0].tv_nsec = atime ? 0 : UTIME_OMIT;
+    times[1].tv_sec = static_cast<time_t>(mtime);
+    times[1].tv_nsec = mtime ? 0 : UTIME_OMIT;
+    if (::utimensat(AT_FDCWD, file.c_str(), times, 0) != 0)
+      throw std::runtime_error(fmt::format("can't write file information for \"{}\" (err: \"{}\"", file.u8string(), strerror(errno)));
+#endif
   }
 }
\ No newline at end of file
@@ -0,0 +1,343 @@
+#pragma once
+#include <string>
+#include <vector>
+#include <array>
+#include <cmath>
+#include <cstring>
+#include <cstdint>
+#include <fstream>
+#include <algorithm>
+#include <filesystem>
+#include <fmt/format.h>
+#include <winpp/hashpp.h>
+#include <winpp/files.hpp>
+
+namespace files
+{
+  // default number of bloom filter bits per digest (~1% false positives)
+  constexpr std::size_t default_bloom_bits = 10;
+
+  namespace details
+  {
+    // header of an index file:
+    //   header | bloom filter (bloom_bits / 8 bytes) | sorted digests (count * digest_size bytes)
+    struct hash_index_header
+    {
+      std::array<char, 8> magic;
+      uint32_t version;
+      uint32_t algorithm;
+      uint64_t digest_size;
+      uint64_t count;
+      uint64_t bloom_bits;
+      uint64_t bloom_hashes;
+      uint64_t bloom_offset;
+      uint64_t table_offset;
+    };
+    constexpr std::array<char, 8> hash_index_magic = { 'W', 'P', 'P', 'H', 'I', 'D', 'X', '1' };
+    constexpr uint32_t hash_index_version = 1;
+
+    // convert an hexadecimal digest to binary, returns false if it isn't valid
+    inline bool from_hex(const std::string& hex, uint8_t* out, const std::size_t size)
+    {
+      if (hex.size() != size * 2)
+        return false;
+      const auto nibble = [](const char c) -> int {
+        if (c >= '0' && c <= '9') return c - '0';
+        if (c >= 'a' && c <= 'f') return c - 'a' + 10;
+        if (c >= 'A' && c <= 'F') return c - 'A' + 10;
+        return -1;
+      };
+      for (std::size_t i = 0; i < size; ++i)
+      {
+        const int hi = nibble(hex[2 * i]);
+        const int lo = nibble(hex[2 * i + 1]);
+        if (hi < 0 || lo < 0)
+          return false;
+        out[i] = static_cast<uint8_t>((hi << 4) | lo);
+      }
+      return true;
+    }
+
+    // first 8 bytes of a digest as a big-endian integer: same order as memcmp
+    inline uint64_t digest_key(const uint8_t* digest)
+    {
+      uint64_t key = 0;
+      for (std::size_t i = 0; i < 8; ++i)
+        key = (key << 8) | digest[i];
+      return key;
+    }
+
+    // positions of the bloom filter bits of a digest (double hashing on the digest bytes)
+    inline uint64_t bloom_position(const uint8_t* digest, const uint64_t i, const uint64_t bits)
+    {
+      uint64_t h1, h2;
+      std::memcpy(&h1, digest, sizeof(h1));
+      std::memcpy(&h2, digest + 8, sizeof(h2));
+      return (h1 + i * (h2 | 1)) & (bits - 1);
+    }
+
+    // sort and deduplicate fixed-size records
+    template <std::size_t N>
+    inline std::size_t sort_records(uint8_t* data, const std::size_t count)
+    {
+      using record = std::array<uint8_t, N>;
+      record* first = reinterpret_cast<record*>(data);
+      std::sort(first, first + count);
+      return static_cast<std::size_t>(std::unique(first, first + count) - first);
+    }
+    inline std::size_t sort_records(std::vector<uint8_t>& data, const std::size_t size)
+    {
+      const std::size_t count = data.size() / size;
+      switch (size)
+      {
+      case 16: return sort_records<16>(data.data(), count);
+      case 20: return sort_records<20>(data.data(), count);
+      case 28: return sort_records<28>(data.data(), count);
+      case 32: return sort_records<32>(data.data(), count);
+      case 48: return sort_records<48>(data.data(), count);
+      case 64: return sort_records<64>(data.data(), count);
+      default: throw std::runtime_error(fmt::format("invalid digest size: {}", size));
+      }
+    }
+  }
+
+  // known-hash index: on-disk sorted table of binary digests mapped in memory,
+  // lookups go through a bloom filter then an interpolation search on the table
+  // (digests are uniformly distributed: a lookup touches only a few pages)
+  class hash_index final
+  {
+    hash_index(const hash_index&) = delete;
+    hash_index& operator=(const hash_index&) = delete;
+
+  public:
+    // map an index file built with hash_index::build (never copied in memory: throws if it can't be mapped)
+    explicit hash_index(const std::filesystem::path& path) :
+      m_view(path, { map_access::random, false, false })
+    {
+      m_data = reinterpret_cast<const uint8_t*>(m_view.data());
+      m_size = m_view.size();
+      if (m_size < sizeof(details::hash_index_header))
+        throw std::runtime_error(fmt::format("invalid index: \"{}\"", path.filename().u8string()));
+
+      // check the header and the layout
+      std::memcpy(&m_header, m_data, sizeof(m_header));
+      const bool valid = m_header.magic == details::hash_index_magic &&
+                         m_header.version == details::hash_index_version &&
+                         m_header.digest_size >= 16 &&
+                         m_header.digest_size == hashpp::digestSize(static_cast<hashpp::ALGORITHMS>(m_header.algorithm)) &&
+                         (m_header.bloom_bits & (m_header.bloom_bits - 1)) == 0 &&
+                         (m_header.bloom_bits == 0 ? m_header.bloom_hashes == 0 :
+                                                     m_header.bloom_bits >= 8 && m_header.bloom_hashes >= 1 && m_header.bloom_hashes <= 16) &&
+                         m_header.bloom_offset >= sizeof(details::hash_index_header) &&
+                         m_header.bloom_offset <= m_header.table_offset &&
+                         m_header.bloom_bits / 8 <= m_header.table_offset - m_header.bloom_offset &&
+                         m_header.table_offset <= m_size &&
+                         m_header.count <= (m_size - m_header.table_offset) / m_header.digest_size;
+      if (!valid)
+        throw std::runtime_error(fmt::format("invalid index: \"{}\"", path.filename().u8string()));
+      m_bloom = m_data + m_header.bloom_offset;
+      m_table = m_data + m_header.table_offset;
+    }
+
+    // algorithm of the digests
+    hashpp::ALGORITHMS algorithm() const
+    {
+      return static_cast<hashpp::ALGORITHMS>(m_header.algorithm);
+    }
+
+    // size of one digest in bytes
+    std::size_t digest_size() const
+    {
+      return static_cast<std::size_t>(m_header.digest_size);
+    }
+
+    // number of digests
+    uint64_t size() const
+    {
+      return m_header.count;
+    }
+
+    // check if a binary digest (digest_size() bytes) is in the index
+    bool contains(const uint8_t* digest) const
+    {
+      // bloom filter: most unknown digests are rejected without touching the table
+      for (uint64_t i = 0; i < m_header.bloom_hashes && m_header.bloom_bits; ++i)
+      {
+        const uint64_t bit = details::bloom_position(digest, i, m_header.bloom_bits);
+        if (!(m_bloom[bit >> 3] & (1u << (bit & 7))))
+          return false;
+      }
+      if (!m_header.count)
+        return false;
+
+      // interpolation search on the first 8 bytes, then binary search when it doesn't converge
+      const std::size_t size = digest_size();
+      const uint64_t key = details::digest_key(digest);
+      uint64_t lo = 0, hi = m_header.count - 1;
+      for (int step = 0; step < 8 && lo < hi; ++step)
+      {
+        const uint64_t klo = details::digest_key(record(lo));
+        const uint64_t khi = details::digest_key(record(hi));
+        if (key < klo || key > khi)
+          return false;
+        if (klo == khi)
+          break;
+        const uint64_t pos = lo + static_cast<uint64_t>(static_cast<long double>(key - klo) / static_cast<long double>(khi - klo) * static_cast<long double>(hi - lo));
+        const int cmp = std::memcmp(record(pos), digest, size);
+        if (cmp == 0)
+          return true;
+        if (cmp < 0)
+          lo = pos + 1;
+        else if (pos == 0)
+          return false;
+        else
+          hi = pos - 1;
+      }
+      while (lo <= hi)
+      {
+        const uint64_t mid = lo + (hi - lo) / 2;
+        const int cmp = std::memcmp(record(mid), digest, size);
+        if (cmp == 0)
+          return true;
+        if (cmp < 0)
+          lo = mid + 1;
+        else if (mid == 0)
+          return false;
+        else
+          hi = mid - 1;
+      }
+      return false;
+    }
+
+    // check if an hexadecimal digest is in the index
+    bool contains(const std::string& hex) const
+    {
+      std::array<uint8_t, 64> digest;
+      return details::from_hex(hex, digest.data(), digest_size()) && contains(digest.data());
+    }
+
+    // check each digest of a collection (computed with the same algorithm)
+    std::vector<bool> contains(const hashpp::digestCollection::view& digests) const
+    {
+      if (digests.digestSize() != digest_size())
+        throw std::runtime_error(fmt::format("invalid digest size: {} (index: {})", digests.digestSize(), digest_size()));
+      std::vector<bool> found(digests.size());
+      for (std::size_t i = 0; i < digests.size(); ++i)
+        found[i] = contains(digests[i]);
+      return found;
+    }
+
+    // hash a file with the algorithm of the index and check if it is known
+    bool contains_file(const std::filesystem::path& file) const
+    {
+      const hashpp::hash hash = hashpp::get::getFileHash(algorithm(), file.string());
+      if (!hash.valid())
+        throw std::runtime_error(fmt::format("can't open file: \"{}\"", file.filename().u8string()));
+      return contains(hash.getString());
+    }
+
+    // build an index file from binary digests (count * digestSize(algorithm) bytes, any order, duplicates allowed)
+    static void build(const std::filesystem::path& path,
+                      const hashpp::ALGORITHMS algorithm,
+                      const uint8_t* digests,
+                      const std::size_t count,
+                      const std::size_t bloom_bits_per_digest = default_bloom_bits)
+    {
+      const std::size_t size = hashpp::digestSize(algorithm);
+      std::vector<uint8_t> table(digests, digests + count * size);
+      write(path, algorithm, table, bloom_bits_per_digest);
+    }
+
+    // build an index file from hexadecimal digests
+    static void build(const std::filesystem::path& path,
+                      const hashpp::ALGORITHMS algorithm,
+                      const std::vector<std::string>& digests,
+                      const std::size_t bloom_bits_per_digest = default_bloom_bits)
+    {
+      const std::size_t size = hashpp::digestSize(algorithm);
+      std::vector<uint8_t> table(digests.size() * size);
+      for (std::size_t i = 0; i < digests.size(); ++i)
+      {
+        if (!details::from_hex(digests[i], table.data() + i * size, size))
+          throw std::runtime_error(fmt::format("invalid digest: \"{}\"", digests[i]));
+      }
+      write(path, algorithm, table, bloom_bits_per_digest);
+    }
+
+    // build an index file from the hashes of a list of files
+    static void build_from_files(const std::filesystem::path& path,
+                                 const hashpp::ALGORITHMS algorithm,
+                                 const std::vector<std::filesystem::path>& files,
+                                 const std::size_t bloom_bits_per_digest = default_bloom_bits)
+    {
+      std::vector<std::string> paths;
+      paths.reserve(files.size());
+      for (const auto& file : files)
+        paths.push_back(file.string());
+      const hashpp::digestCollection digests = hashpp::get::getFilesDigests({ { algorithm, paths } });
+      const hashpp::digestCollection::view view = digests[algorithm];
+      build(path, algorithm, view.data(), view.size(), bloom_bits_per_digest);
+    }
+
+  private:
+    const uint8_t* record(const uint64_t i) const
+    {
+      return m_table + i * m_header.digest_size;
+    }
+
+    // sort the digests, fill the bloom filter and write the index file
+    static void write(const std::filesystem::path& path,
+                      const hashpp::ALGORITHMS algorithm,
+                      std::vector<uint8_t>& table,
+                      const std::size_t bloom_bits_per_digest)
+    {
+      const std::size_t size = hashpp::digestSize(algorithm);
+      const std::size_t count = details::sort_records(table, size);
+
+      // bloom filter: power of 2 number of bits, k = bits per digest * ln(2)
+      details::hash_index_header header = {};
+      header.magic = details::hash_index_magic;
+      header.version = details::hash_index_version;
+      header.algorithm = static_cast<uint32_t>(algorithm);
+      header.digest_size = size;
+      header.count = count;
+      if (bloom_bits_per_digest && count)
+      {
+        header.bloom_bits = 64;
+        while (header.bloom_bits < static_cast<uint64_t>(count) * bloom_bits_per_digest)
+          header.bloom_bits <<= 1;
+        const double bits_per_digest = static_cast<double>(header.bloom_bits) / static_cast<double>(count);
+        header.bloom_hashes = std::clamp<uint64_t>(static_cast<uint64_t>(std::lround(bits_per_digest * 0.6931)), 1, 16);
+      }
+      header.bloom_offset = sizeof(header);
+      header.table_offset = header.bloom_offset + header.bloom_bits / 8;
+
+      std::vector<uint8_t> bloom(static_cast<std::size_t>(header.bloom_bits / 8));
+      for (std::size_t i = 0; i < count && header.bloom_bits; ++i)
+      {
+        for (uint64_t k = 0; k < header.bloom_hashes; ++k)
+        {
+          const uint64_t bit = details::bloom_position(table.data() + i * size, k, header.bloom_bits);
+          bloom[static_cast<std::size_t>(bit >> 3)] |= static_cast<uint8_t>(1u << (bit & 7));
+        }
+      }
+
+      std::ofstream file(path, std::ios::binary | std::ios::trunc);
+      if (!file.good())
+        throw std::runtime_error(fmt::format("can't create file: \"{}\"", path.filename().u8string()));
+      file.write(reinterpret_cast<const char*>(&header), sizeof(header));
+      file.write(reinterpret_cast<const char*>(bloom.data()), static_cast<std::streamsize>(bloom.size()));
+      file.write(reinterpret_cast<const char*>(table.data()), static_cast<std::streamsize>(count * size));
+      if (!file.good())
+        throw std::runtime_error(fmt::format("can't write file: \"{}\"", path.filename().u8string()));
+    }
+
+  private:
+    file_view m_view;
+    details::hash_index_header m_header = {};
+    const uint8_t* m_data = nullptr;
+    const uint8_t* m_bloom = nullptr;
+    const uint8_t* m_table = nullptr;
+    std::size_t m_size = 0;
+  };
+}
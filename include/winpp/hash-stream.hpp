@@ -0,0 +1,387 @@
+#pragma once
+#include <string>
+#include <vector>
+#include <memory>
+#include <istream>
+#include <ostream>
+#include <fstream>
+#include <streambuf>
+#include <algorithm>
+#include <filesystem>
+#include <functional>
+#include <fmt/format.h>
+#include <winpp/hashpp.h>
+
+namespace files
+{
+  // set of hashers updated together: the same bytes are hashed with several algorithms in one pass
+  class digester final
+  {
+  public:
+    explicit digester(const std::vector<hashpp::ALGORITHMS>& algorithms = { hashpp::ALGORITHMS::SHA2_256 }) :
+      m_algorithms(algorithms),
+      m_hashers(),
+      m_size(0)
+    {
+      for (const auto& algorithm : m_algorithms)
+      {
+        m_hashers.emplace_back(hashpp::get::getHasher(algorithm));
+        if (!m_hashers.back())
+          throw std::runtime_error(fmt::format("invalid algorithm: {}", static_cast<int>(algorithm)));
+      }
+      reset();
+    }
+
+    // restart all the hashes
+    void reset()
+    {
+      for (auto& hasher : m_hashers)
+        hasher->init();
+      m_size = 0;
+    }
+
+    // hash the next bytes
+    void update(const void* data, const std::size_t len)
+    {
+      for (auto& hasher : m_hashers)
+        hasher->update(static_cast<const uint8_t*>(data), len);
+      m_size += len;
+    }
+
+    // number of bytes hashed
+    uint64_t size() const
+    {
+      return m_size;
+    }
+
+    // algorithms of the hashes
+    const std::vector<hashpp::ALGORITHMS>& algorithms() const
+    {
+      return m_algorithms;
+    }
+
+    // get the hexadecimal hashes (in the order of the algorithms) and restart
+    std::vector<std::string> finalize()
+    {
+      std::vector<std::string> hashes;
+      for (auto& hasher : m_hashers)
+        hashes.push_back(hasher->finalize());
+      reset();
+      return hashes;
+    }
+
+  private:
+    std::vector<hashpp::ALGORITHMS> m_algorithms;
+    std::vector<std::unique_ptr<hashpp::common>> m_hashers;
+    uint64_t m_size;
+  };
+
+  // input stream buffer hashing the bytes read from another stream buffer:
+  // only the bytes actually consumed are hashed (putback is limited to the current buffer)
+  class hashing_istreambuf final : public std::streambuf
+  {
+  public:
+    hashing_istreambuf(std::streambuf* source, digester& digest, const std::size_t buffer_size = 64 * 1024) :
+      m_source(source),
+      m_digest(digest),
+      m_buffer(std::max<std::size_t>(buffer_size, 1)),
+      m_mark(nullptr)
+    {
+      setg(m_buffer.data(), m_buffer.data(), m_buffer.data());
+      m_mark = m_buffer.data();
+    }
+
+    // hash the bytes consumed so far (called before reading the digest)
+    void flush_digest()
+    {
+      if (gptr() > m_mark)
+        m_digest.update(m_mark, static_cast<std::size_t>(gptr() - m_mark));
+      m_mark = gptr();
+    }
+
+  protected:
+    int_type underflow() override
+    {
+      if (gptr() < egptr())
+        return traits_type::to_int_type(*gptr());
+      flush_digest();
+      const std::streamsize n = m_source->sgetn(m_buffer.data(), static_cast<std::streamsize>(m_buffer.size()));
+      setg(m_buffer.data(), m_buffer.data(), m_buffer.data() + std::max<std::streamsize>(n, 0));
+      m_mark = m_buffer.data();
+      return n > 0 ? traits_type::to_int_type(*gptr()) : traits_type::eof();
+    }
+
+    // large reads go directly from the source to the caller buffer
+    std::streamsize xsgetn(char* s, std::streamsize count) override
+    {
+      std::streamsize total = std::min<std::streamsize>(count, egptr() - gptr());
+      std::copy(gptr(), gptr() + total, s);
+      gbump(static_cast<int>(total));
+      if (total == count)
+        return total;
+
+      flush_digest();
+      const std::streamsize n = m_source->sgetn(s + total, count - total);
+      if (n > 0)
+      {
+        m_digest.update(s + total, static_cast<std::size_t>(n));
+        total += n;
+      }
+      return total;
+    }
+
+  private:
+    std::streambuf* m_source;
+    digester& m_digest;
+    std::vector<char> m_buffer;
+    char* m_mark;
+  };
+
+  // output stream buffer hashing the bytes written to another stream buffer
+  class hashing_ostreambuf final : public std::streambuf
+  {
+  public:
+    hashing_ostreambuf(std::streambuf* sink, digester& digest, const std::size_t buffer_size = 64 * 1024) :
+      m_sink(sink),
+      m_digest(digest),
+      m_buffer(std::max<std::size_t>(buffer_size, 1))
+    {
+      setp(m_buffer.data(), m_buffer.data() + m_buffer.size());
+    }
+
+    ~hashing_ostreambuf()
+    {
+      sync();
+    }
+
+  protected:
+    int_type overflow(int_type ch) override
+    {
+      if (!write_buffer())
+        return traits_type::eof();
+      if (!traits_type::eq_int_type(ch, traits_type::eof()))
+      {
+        *pptr() = traits_type::to_char_type(ch);
+        pbump(1);
+      }
+      return traits_type::not_eof(ch);
+    }
+
+    int sync() override
+    {
+      return write_buffer() && m_sink->pubsync() == 0 ? 0 : -1;
+    }
+
+    // large writes go directly from the caller buffer to the sink
+    std::streamsize xsputn(const char* s, std::streamsize count) override
+    {
+      if (count < epptr() - pptr())
+      {
+        std::copy(s, s + count, pptr());
+        pbump(static_cast<int>(count));
+        return count;
+      }
+      if (!write_buffer())
+        return 0;
+      const std::streamsize n = m_sink->sputn(s, count);
+      if (n > 0)
+        m_digest.update(s, static_cast<std::size_t>(n));
+      return n;
+    }
+
+  private:
+    // hash and forward the buffered bytes
+    bool write_buffer()
+    {
+      const std::streamsize len = pptr() - pbase();
+      if (len == 0)
+        return true;
+      const std::streamsize n = m_sink->sputn(pbase(), len);
+      if (n > 0)
+        m_digest.update(pbase(), static_cast<std::size_t>(n));
+      setp(m_buffer.data(), m_buffer.data() + m_buffer.size());
+      return n == len;
+    }
+
+  private:
+    std::streambuf* m_sink;
+    digester& m_digest;
+    std::vector<char> m_buffer;
+  };
+
+  // input stream hashing everything read from another stream
+  //   files::hashing_istream in(file, { hashpp::ALGORITHMS::SHA2_256 });
+  //   ... read from in ...
+  //   const auto hashes = in.finalize();
+  class hashing_istream final : public std::istream
+  {
+  public:
+    hashing_istream(std::istream& source, const std::vector<hashpp::ALGORITHMS>& algorithms = { hashpp::ALGORITHMS::SHA2_256 }) :
+      std::istream(nullptr),
+      m_digest(algorithms),
+      m_buf(source.rdbuf(), m_digest)
+    {
+      rdbuf(&m_buf);
+    }
+
+    // number of bytes hashed
+    uint64_t size()
+    {
+      m_buf.flush_digest();
+      return m_digest.size();
+    }
+
+    // get the hexadecimal hashes of the bytes read so far (in the order of the algorithms)
+    std::vector<std::string> finalize()
+    {
+      m_buf.flush_digest();
+      return m_digest.finalize();
+    }
+
+  private:
+    digester m_digest;
+    hashing_istreambuf m_buf;
+  };
+
+  // output stream hashing everything written to another stream
+  class hashing_ostream final : public std::ostream
+  {
+  public:
+    hashing_ostream(std::ostream& sink, const std::vector<hashpp::ALGORITHMS>& algorithms = { hashpp::ALGORITHMS::SHA2_256 }) :
+      std::ostream(nullptr),
+      m_digest(algorithms),
+      m_buf(sink.rdbuf(), m_digest)
+    {
+      rdbuf(&m_buf);
+    }
+
+    // number of bytes hashed
+    uint64_t size()
+    {
+      flush();
+      return m_digest.size();
+    }
+
+    // flush and get the hexadecimal hashes of the bytes written so far (in the order of the algorithms)
+    std::vector<std::string> finalize()
+    {
+      flush();
+      return m_digest.finalize();
+    }
+
+  private:
+    digester m_digest;
+    hashing_ostreambuf m_buf;
+  };
+
+  // raw reader hashing the bytes returned by a read function (ex: fread, ReadFile, recv)
+  class hashing_reader final
+  {
+  public:
+    using read_function = std::function<std::size_t(void*, std::size_t)>;
+
+    hashing_reader(const read_function& source, digester& digest) :
+      m_source(source),
+      m_digest(digest)
+    {
+    }
+
+    // read up to len bytes, returns the number of bytes read
+    std::size_t read(void* data, const std::size_t len)
+    {
+      const std::size_t n = m_source(data, len);
+      m_digest.update(data, n);
+      return n;
+    }
+
+  private:
+    read_function m_source;
+    digester& m_digest;
+  };
+
+  // raw writer hashing the bytes accepted by a write function (ex: fwrite, WriteFile, send)
+  class hashing_writer final
+  {
+  public:
+    using write_function = std::function<std::size_t(const void*, std::size_t)>;
+
+    hashing_writer(const write_function& sink, digester& digest) :
+      m_sink(sink),
+      m_digest(digest)
+    {
+    }
+
+    // write up to len bytes, returns the number of bytes written
+    std::size_t write(const void* data, const std::size_t len)
+    {
+      const std::size_t n = m_sink(data, len);
+      m_digest.update(data, n);
+      return n;
+    }
+
+  private:
+    write_function m_sink;
+    digester& m_digest;
+  };
+
+  // read a file in memory and hash it in the same pass
+  inline const std::string read(const std::filesystem::path& path, digester& digest)
+  {
+    const hashpp::io::file file(path);
+    if (!file.valid())
+      throw std::runtime_error(fmt::format("can't open file: \"{}\"", path.filename().u8string()));
+    const std::size_t size = static_cast<std::size_t>(file.size());
+    std::string str(size, 0);
+
+    // only read the data extents, each one is hashed while it is still in the cache
+    uint64_t start = 0;
+    uint64_t end = 0;
+    std::size_t hashed = 0;
+    for (uint64_t offset = 0; offset < size && file.nextData(offset, start, end) && start < size; offset = end)
+    {
+      end = std::min<uint64_t>(end, size);
+      const std::size_t len = static_cast<std::size_t>(end - start);
+      const std::size_t n = file.readAt(start, reinterpret_cast<uint8_t*>(&str[start]), len);
+      digest.update(str.data() + hashed, static_cast<std::size_t>(start) + n - hashed);
+      hashed = static_cast<std::size_t>(start) + n;
+      if (n < len)
+      {
+        str.resize(hashed);
+        return str;
+      }
+    }
+    digest.update(str.data() + hashed, str.size() - hashed);
+    return str;
+  }
+
+  // copy a file and get the hashes of the copied bytes: the destination doesn't need to be read back
+  inline const std::vector<std::string> copy_file(const std::filesystem::path& from,
+                                                  const std::filesystem::path& to,
+                                                  const std::vector<hashpp::ALGORITHMS>& algorithms = { hashpp::ALGORITHMS::SHA2_256 })
+  {
+    if (!std::filesystem::is_regular_file(from))
+      throw std::runtime_error(fmt::format("can't open file: \"{}\"", from.filename().u8string()));
+    std::ofstream out(to, std::ios::binary | std::ios::trunc);
+    if (!out.good())
+      throw std::runtime_error(fmt::format("can't create file: \"{}\"", to.filename().u8string()));
+
+    // the next reads are in flight while the current buffer is hashed and written
+    digester digest(algorithms);
+    hashpp::io::reader reader(from);
+    const uint8_t* data = nullptr;
+    std::size_t len = 0;
+    while (reader.next(data, len))
+    {
+      out.write(reinterpret_cast<const char*>(data), static_cast<std::streamsize>(len));
+      if (!out.good())
+        throw std::runtime_error(fmt::format("can't write file: \"{}\"", to.filename().u8string()));
+      digest.update(data, len);
+    }
+    if (reader.failed())
+      throw std::runtime_error(fmt::format("can't read file: \"{}\"", from.filename().u8string()));
+    out.close();
+    if (out.fail())
+      throw std::runtime_error(fmt::format("can't write file: \"{}\"", to.filename().u8string()));
+    return digest.finalize();
+  }
+}
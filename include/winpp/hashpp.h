@@ -68,6 +68,39 @@
 #include <array>
 #include <vector>
 #include <chrono>
+#include <cstring>
+#include <thread>
+#include <mutex>
+#include <condition_variable>
+#include <algorithm>
+#include <memory>
+#include <atomic>
+#include <functional>
+
+#if defined(_WIN32)
+	#include <windows.h>
+	#include <winioctl.h>
+#else
+	#include <cerrno>
+	#include <fcntl.h>
+	#include <unistd.h>
+	#include <sys/stat.h>
+
+	// io_uring is used for file hashing when the kernel headers are available,
+	// define HASHPP_NO_IO_URING to always use the reader thread instead
+	#if defined(__linux__) && !defined(HASHPP_NO_IO_URING) && __has_include(<linux/io_uring.h>)
+		#define HASHPP_IO_URING
+		#include <linux/io_uring.h>
+		#include <sys/mman.h>
+		#include <sys/syscall.h>
+	#endif
+
+	// optional kernel crypto api backend (define HASHPP_USE_AF_ALG to enable it)
+	#if defined(__linux__) && defined(HASHPP_USE_AF_ALG)
+		#include <sys/socket.h>
+		#include <linux/if_alg.h>
+	#endif
+#endif
 
 namespace hashpp {
 	enum class ALGORITHMS : uint8_t {
@@ -82,11 +115,675 @@ namespace hashpp {
 		SHAKE256 */
 	};
 
+	// number of values in ALGORITHMS
+	constexpr size_t algorithmCount = static_cast<size_t>(hashpp::ALGORITHMS::SHA2_512_256) + 1;
+
+	// size in bytes of the binary digest of an algorithm
+	inline size_t digestSize(hashpp::ALGORITHMS algorithm) noexcept {
+		switch (algorithm) {
+			case hashpp::ALGORITHMS::MD5: return 16;
+			case hashpp::ALGORITHMS::MD4: return 16;
+			case hashpp::ALGORITHMS::MD2: return 16;
+			case hashpp::ALGORITHMS::SHA1: return 20;
+			case hashpp::ALGORITHMS::SHA2_224: return 28;
+			case hashpp::ALGORITHMS::SHA2_256: return 32;
+			case hashpp::ALGORITHMS::SHA2_384: return 48;
+			case hashpp::ALGORITHMS::SHA2_512: return 64;
+			case hashpp::ALGORITHMS::SHA2_512_224: return 28;
+			case hashpp::ALGORITHMS::SHA2_512_256: return 32;
+			default: return 0;
+		}
+	}
+
+	// low-level file access used to hash files: the reads are pipelined
+	// so that the next buffers are being read while the current one is hashed
+	namespace io {
+		// default size of one read and default number of reads kept in flight
+		constexpr size_t defaultBufferSize = 1024 * 1024;
+		constexpr size_t defaultDepth = 4;
+
+		// default number of bytes hashed between two progress notifications
+		constexpr uint64_t defaultProgressGranularity = 16 * 1024 * 1024;
+
+		// options used when hashing a file
+		struct fileOptions {
+			size_t bufferSize = defaultBufferSize;
+			size_t depth = defaultDepth;
+
+			// called with the number of bytes hashed so far, at most once every
+			// 'progressGranularity' bytes and once at the end of the file
+			std::function<void(uint64_t)> progress;
+			uint64_t progressGranularity = defaultProgressGranularity;
+
+			// checked between two buffers: the hashing stops as soon as it is set
+			const std::atomic<bool>* cancel = nullptr;
+		};
+
+		// native read-only file handle with positional reads
+		class file {
+			public:
+				explicit file(const std::filesystem::path& path) noexcept {
+				#if defined(_WIN32)
+					this->handle = CreateFileW(path.c_str(), GENERIC_READ, FILE_SHARE_READ | FILE_SHARE_WRITE,
+					                           nullptr, OPEN_EXISTING, FILE_FLAG_SEQUENTIAL_SCAN, nullptr);
+				#else
+					this->fd = ::open(path.c_str(), O_RDONLY | O_CLOEXEC);
+					#if defined(POSIX_FADV_SEQUENTIAL)
+					if (this->fd >= 0) {
+						posix_fadvise(this->fd, 0, 0, POSIX_FADV_SEQUENTIAL);
+					}
+					#endif
+				#endif
+				}
+				file(const file&) = delete;
+				file& operator=(const file&) = delete;
+
+				~file() {
+				#if defined(_WIN32)
+					if (this->valid()) {
+						CloseHandle(this->handle);
+					}
+				#else
+					if (this->valid()) {
+						::close(this->fd);
+					}
+				#endif
+				}
+
+				bool valid() const noexcept {
+				#if defined(_WIN32)
+					return this->handle != INVALID_HANDLE_VALUE;
+				#else
+					return this->fd >= 0;
+				#endif
+				}
+
+				// check if the file is a regular file (pipes and devices have no reliable size)
+				bool regular() const noexcept {
+				#if defined(_WIN32)
+					return this->valid() && GetFileType(this->handle) == FILE_TYPE_DISK;
+				#else
+					struct stat st;
+					return this->valid() && fstat(this->fd, &st) == 0 && S_ISREG(st.st_mode);
+				#endif
+				}
+
+				// size of the file in bytes (0 when unknown)
+				uint64_t size() const noexcept {
+				#if defined(_WIN32)
+					LARGE_INTEGER li;
+					return this->valid() && GetFileSizeEx(this->handle, &li) ? static_cast<uint64_t>(li.QuadPart) : 0;
+				#else
+					struct stat st;
+					return this->valid() && fstat(this->fd, &st) == 0 ? static_cast<uint64_t>(st.st_size) : 0;
+				#endif
+				}
+
+				// check if a read has failed (a short read is then not the end of the file)
+				bool failed() const noexcept { return this->error; }
+
+				// read up to len bytes at offset, only returns less than len at end of file or on error
+				size_t readAt(uint64_t offset, uint8_t* buf, size_t len) const noexcept {
+					size_t total = 0;
+					while (this->valid() && total < len) {
+					#if defined(_WIN32)
+						OVERLAPPED ov = {};
+						ov.Offset = static_cast<DWORD>(offset + total);
+						ov.OffsetHigh = static_cast<DWORD>((offset + total) >> 32);
+						DWORD n = 0;
+						const DWORD chunk = static_cast<DWORD>((std::min)(len - total, static_cast<size_t>(1) << 30));
+						if (!ReadFile(this->handle, buf + total, chunk, &n, &ov)) {
+							this->error = GetLastError() != ERROR_HANDLE_EOF;
+							break;
+						}
+						if (n == 0) {
+							break;
+						}
+					#else
+						const ssize_t n = ::pread(this->fd, buf + total, len - total, static_cast<off_t>(offset + total));
+						if (n < 0 && errno == EINTR) {
+							continue;
+						}
+						if (n < 0) {
+							this->error = true;
+						}
+						if (n <= 0) {
+							break;
+						}
+					#endif
+						total += static_cast<size_t>(n);
+					}
+					return total;
+				}
+
+				// read up to len bytes at the current position (pipes and devices can't be read at an offset),
+				// only returns less than len at end of file or on error
+				size_t read(uint8_t* buf, size_t len) const noexcept {
+					size_t total = 0;
+					while (this->valid() && total < len) {
+					#if defined(_WIN32)
+						DWORD n = 0;
+						const DWORD chunk = static_cast<DWORD>((std::min)(len - total, static_cast<size_t>(1) << 30));
+						if (!ReadFile(this->handle, buf + total, chunk, &n, nullptr)) {
+							const DWORD err = GetLastError();
+							this->error = err != ERROR_HANDLE_EOF && err != ERROR_BROKEN_PIPE;
+							break;
+						}
+						if (n == 0) {
+							break;
+						}
+					#else
+						const ssize_t n = ::read(this->fd, buf + total, len - total);
+						if (n < 0 && errno == EINTR) {
+							continue;
+						}
+						if (n < 0) {
+							this->error = true;
+						}
+						if (n <= 0) {
+							break;
+						}
+					#endif
+						total += static_cast<size_t>(n);
+					}
+					return total;
+				}
+
+				// find the first data extent [start, end) at or after offset, returns false when
+				// only a hole is left (when holes can't be queried the whole file is data)
+				bool nextData(uint64_t offset, uint64_t& start, uint64_t& end) const noexcept {
+					start = offset;
+					end = UINT64_MAX;
+				#if defined(_WIN32)
+					FILE_ALLOCATED_RANGE_BUFFER query, range;
+					query.FileOffset.QuadPart = static_cast<LONGLONG>(offset);
+					query.Length.QuadPart = static_cast<LONGLONG>(this->size() - (std::min)(this->size(), offset));
+					DWORD n = 0;
+					if (!DeviceIoControl(this->handle, FSCTL_QUERY_ALLOCATED_RANGES, &query, sizeof(query), &range, sizeof(range), &n, nullptr) &&
+					    GetLastError() != ERROR_MORE_DATA) {
+						return true;
+					}
+					if (n < sizeof(range)) {
+						return false;
+					}
+					start = (std::max)(offset, static_cast<uint64_t>(range.FileOffset.QuadPart));
+					end = static_cast<uint64_t>(range.FileOffset.QuadPart + range.Length.QuadPart);
+				#elif defined(SEEK_DATA) && defined(SEEK_HOLE)
+					const off_t data = ::lseek(this->fd, static_cast<off_t>(offset), SEEK_DATA);
+					if (data < 0) {
+						return errno != ENXIO;
+					}
+					const off_t hole = ::lseek(this->fd, data, SEEK_HOLE);
+					start = static_cast<uint64_t>(data);
+					end = hole < 0 ? UINT64_MAX : static_cast<uint64_t>(hole);
+				#endif
+					return true;
+				}
+
+			#if !defined(_WIN32)
+				int native() const noexcept { return this->fd; }
+			#endif
+
+			private:
+			#if defined(_WIN32)
+				HANDLE handle = INVALID_HANDLE_VALUE;
+			#else
+				int fd = -1;
+			#endif
+				mutable bool error = false;
+		};
+
+		#if defined(HASHPP_IO_URING)
+		// minimal io_uring submission/completion ring (raw syscalls, no liburing)
+		class ring {
+			public:
+				ring() noexcept = default;
+				ring(const ring&) = delete;
+				ring& operator=(const ring&) = delete;
+
+				~ring() {
+					if (this->sqes != MAP_FAILED) {
+						munmap(this->sqes, this->sqesSize);
+					}
+					if (this->cqPtr != MAP_FAILED && this->cqPtr != this->sqPtr) {
+						munmap(this->cqPtr, this->cqSize);
+					}
+					if (this->sqPtr != MAP_FAILED) {
+						munmap(this->sqPtr, this->sqSize);
+					}
+					if (this->fd >= 0) {
+						::close(this->fd);
+					}
+				}
+
+				// create the ring, returns false when io_uring isn't usable (old kernel, seccomp, ...)
+				bool init(unsigned entries) noexcept {
+					io_uring_params p;
+					std::memset(&p, 0, sizeof(p));
+					this->fd = static_cast<int>(syscall(__NR_io_uring_setup, entries, &p));
+					if (this->fd < 0) {
+						return false;
+					}
+
+					this->sqSize = p.sq_off.array + p.sq_entries * sizeof(unsigned);
+					this->cqSize = p.cq_off.cqes + p.cq_entries * sizeof(io_uring_cqe);
+					const bool single = (p.features & IORING_FEAT_SINGLE_MMAP) != 0;
+					if (single) {
+						this->sqSize = this->cqSize = (std::max)(this->sqSize, this->cqSize);
+					}
+					this->sqPtr = mmap(nullptr, this->sqSize, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_POPULATE, this->fd, IORING_OFF_SQ_RING);
+					if (this->sqPtr == MAP_FAILED) {
+						return false;
+					}
+					this->cqPtr = single ? this->sqPtr :
+						mmap(nullptr, this->cqSize, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_POPULATE, this->fd, IORING_OFF_CQ_RING);
+					if (this->cqPtr == MAP_FAILED) {
+						return false;
+					}
+					this->sqesSize = p.sq_entries * sizeof(io_uring_sqe);
+					this->sqes = mmap(nullptr, this->sqesSize, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_POPULATE, this->fd, IORING_OFF_SQES);
+					if (this->sqes == MAP_FAILED) {
+						return false;
+					}
+
+					uint8_t* sq = static_cast<uint8_t*>(this->sqPtr);
+					uint8_t* cq = static_cast<uint8_t*>(this->cqPtr);
+					this->sqTail = reinterpret_cast<unsigned*>(sq + p.sq_off.tail);
+					this->sqMask = reinterpret_cast<unsigned*>(sq + p.sq_off.ring_mask);
+					this->sqArray = reinterpret_cast<unsigned*>(sq + p.sq_off.array);
+					this->cqHead = reinterpret_cast<unsigned*>(cq + p.cq_off.head);
+					this->cqTail = reinterpret_cast<unsigned*>(cq + p.cq_off.tail);
+					this->cqMask = reinterpret_cast<unsigned*>(cq + p.cq_off.ring_mask);
+					this->cqes = reinterpret_cast<io_uring_cqe*>(cq + p.cq_off.cqes);
+					return true;
+				}
+
+				// queue and submit one read, returns false if the kernel refused it
+				bool read(int file, uint8_t* buf, size_t len, uint64_t offset, uint64_t userData) noexcept {
+					const unsigned tail = *this->sqTail;
+					const unsigned index = tail & *this->sqMask;
+					io_uring_sqe* sqe = static_cast<io_uring_sqe*>(this->sqes) + index;
+					std::memset(sqe, 0, sizeof(*sqe));
+					sqe->opcode = IORING_OP_READ;
+					sqe->fd = file;
+					sqe->addr = reinterpret_cast<uint64_t>(buf);
+					sqe->len = static_cast<uint32_t>(len);
+					sqe->off = offset;
+					sqe->user_data = userData;
+					this->sqArray[index] = index;
+					__atomic_store_n(this->sqTail, tail + 1, __ATOMIC_RELEASE);
+
+					int ret;
+					do {
+						ret = static_cast<int>(syscall(__NR_io_uring_enter, this->fd, 1, 0, 0, nullptr, 0));
+					} while (ret < 0 && errno == EINTR);
+					return ret == 1;
+				}
+
+				// wait for the next completion, returns false if the ring is unusable
+				bool wait(uint64_t& userData, int& result) noexcept {
+					for (;;) {
+						const unsigned head = *this->cqHead;
+						if (head != __atomic_load_n(this->cqTail, __ATOMIC_ACQUIRE)) {
+							const io_uring_cqe* cqe = this->cqes + (head & *this->cqMask);
+							userData = cqe->user_data;
+							result = cqe->res;
+							__atomic_store_n(this->cqHead, head + 1, __ATOMIC_RELEASE);
+							return true;
+						}
+						if (syscall(__NR_io_uring_enter, this->fd, 0, 1, IORING_ENTER_GETEVENTS, nullptr, 0) < 0 &&
+							errno != EINTR && errno != EAGAIN && errno != EBUSY) {
+							return false;
+						}
+					}
+				}
+
+			private:
+				int fd = -1;
+				void* sqPtr = MAP_FAILED;
+				void* cqPtr = MAP_FAILED;
+				void* sqes = MAP_FAILED;
+				size_t sqSize = 0, cqSize = 0, sqesSize = 0;
+				unsigned *sqTail = nullptr, *sqMask = nullptr, *sqArray = nullptr;
+				unsigned *cqHead = nullptr, *cqTail = nullptr, *cqMask = nullptr;
+				io_uring_cqe* cqes = nullptr;
+		};
+		#endif
+
+		// shared block of zeros used to feed the holes of sparse files to the hashers
+		constexpr size_t zeroPageSize = 64 * 1024;
+		inline const uint8_t* zeroPage() noexcept {
+			static const uint8_t zeros[zeroPageSize] = {};
+			return zeros;
+		}
+
+		// pipelined file reader: keeps up to 'depth' reads in flight (io_uring when
+		// available, a reader thread otherwise) while the caller consumes the buffer
+		// returned by next(), buffers are always returned in file order
+		//
+		// regular files are read by data extents: the holes of sparse files are never
+		// read from the disk but returned as blocks of zeros (see zeroPage)
+		//
+		// files fitting in one buffer are read synchronously in the constructor, pipes
+		// and devices are read sequentially by the reader thread
+		class reader {
+			public:
+				reader(const std::filesystem::path& path, const fileOptions& options = {}) :
+					input(path),
+					bufferSize((std::max)(options.bufferSize, static_cast<size_t>(1))),
+					depth((std::max)(options.depth, static_cast<size_t>(1))) {
+					if (!this->input.valid()) {
+						this->finished = true;
+						return;
+					}
+
+					// files reporting a size are read up to that size, others until a short read
+					if (this->input.regular()) {
+						this->size = this->input.size();
+						this->bounded = this->size > 0;
+					}
+					const bool whole = this->bounded && this->size <= this->bufferSize;
+					if (whole) {
+						this->bufferSize = static_cast<size_t>(this->size);
+						this->depth = 1;
+					}
+					this->storage.reset(new uint8_t[this->bufferSize * this->depth]);
+					this->offsets.assign(this->depth, 0);
+					this->lengths.assign(this->depth, 0);
+					this->ready.assign(this->depth, 0);
+					this->last.assign(this->depth, 0);
+
+					// small file: a single read, no ring or thread to set up
+					if (whole) {
+						this->complete(0, 0, this->bufferSize, this->input.readAt(0, this->storage.get(), this->bufferSize));
+						this->last[0] = 1;
+						this->ready[0] = 1;
+						return;
+					}
+				#if defined(HASHPP_IO_URING)
+					if (this->bounded && this->uring.init(static_cast<unsigned>(this->depth))) {
+						this->useRing = true;
+						this->expected.assign(this->depth, 0);
+						this->pending.assign(this->depth, 0);
+						for (size_t slot = 0; slot < this->depth && !this->planned; ++slot) {
+							this->submit(slot);
+						}
+						return;
+					}
+				#endif
+					this->producer = std::thread(&reader::produce, this);
+				}
+				reader(const reader&) = delete;
+				reader& operator=(const reader&) = delete;
+
+				~reader() {
+					if (this->producer.joinable()) {
+						{
+							std::lock_guard<std::mutex> lck(this->mutex);
+							this->stop = true;
+						}
+						this->cvFree.notify_all();
+						this->producer.join();
+					}
+				#if defined(HASHPP_IO_URING)
+					// the kernel may still be writing into our buffers: drain them first
+					while (this->useRing && this->inFlight()) {
+						if (!this->reap()) {
+							this->abandon();
+						}
+					}
+				#endif
+				}
+
+				// check if a read has failed, to be called once next() returned false:
+				// the data returned so far is then not the whole file
+				bool failed() const noexcept { return this->input.failed(); }
+
+				// get the next buffer of the file (valid until the next call), returns false at end of file or on error
+				bool next(const uint8_t*& data, size_t& len) {
+					for (;;) {
+						const size_t slot = this->sequence % this->depth;
+						if (!this->holding) {
+							if (this->finished) {
+								return false;
+							}
+							this->acquire(slot);
+							this->holding = true;
+							this->emitted = false;
+						}
+
+						// hole before the buffer: feed zeros without any read
+						if (this->position < this->offsets[slot]) {
+							len = static_cast<size_t>((std::min)(static_cast<uint64_t>(zeroPageSize), this->offsets[slot] - this->position));
+							data = zeroPage();
+							this->position += len;
+							return true;
+						}
+						if (!this->emitted && this->lengths[slot]) {
+							this->emitted = true;
+							data = this->storage.get() + slot * this->bufferSize;
+							len = this->lengths[slot];
+							this->position += len;
+							return true;
+						}
+
+						// buffer consumed: give it back to the reader
+						this->finished = this->last[slot] != 0;
+						this->holding = false;
+						this->release(slot);
+						++this->sequence;
+					}
+				}
+
+			private:
+				// compute the next range to read, len = 0 marks the end of the file at offset
+				void plan(uint64_t& offset, size_t& len) {
+					if (!this->bounded) {
+						offset = this->cursor;
+						len = this->bufferSize;
+						return;
+					}
+					if (this->cursor >= this->extentEnd) {
+						uint64_t start = 0, end = 0;
+						if (this->cursor < this->size && this->input.nextData(this->cursor, start, end) && start < this->size) {
+							this->cursor = start;
+							this->extentEnd = (std::min)(end, this->size);
+						}
+						else {
+							this->cursor = this->extentEnd = this->size;
+						}
+					}
+					offset = this->cursor;
+					len = static_cast<size_t>((std::min)(static_cast<uint64_t>(this->bufferSize), this->extentEnd - this->cursor));
+					this->cursor += len;
+					this->planned = len == 0;
+				}
+
+				// store the result of a read into a slot (must be called in plan order)
+				void complete(size_t slot, uint64_t offset, size_t requested, size_t n) {
+					this->offsets[slot] = offset;
+					this->lengths[slot] = n;
+					this->last[slot] = (requested == 0 || n < requested || this->input.failed()) ? 1 : 0;
+					if (!this->bounded) {
+						this->cursor = offset + n;
+					}
+				}
+
+				// wait for the read of a slot to complete
+				void acquire(size_t slot) {
+				#if defined(HASHPP_IO_URING)
+					if (this->useRing) {
+						while (!this->ready[slot]) {
+							if (this->ringFailed || !this->reap()) {
+								// ring is unusable: read synchronously, nothing else can be expected from it
+								this->abandon();
+								uint8_t* buf = this->storage.get() + slot * this->bufferSize;
+								this->complete(slot, this->offsets[slot], this->expected[slot], this->input.readAt(this->offsets[slot], buf, this->expected[slot]));
+								this->ready[slot] = 1;
+							}
+						}
+						return;
+					}
+				#endif
+					std::unique_lock<std::mutex> lck(this->mutex);
+					this->cvReady.wait(lck, [&] { return this->ready[slot] != 0; });
+				}
+
+				// give a slot back to the reader so that it can be refilled
+				void release(size_t slot) {
+				#if defined(HASHPP_IO_URING)
+					if (this->useRing) {
+						this->ready[slot] = 0;
+						if (!this->planned) {
+							this->submit(slot);
+						}
+						return;
+					}
+				#endif
+					{
+						std::lock_guard<std::mutex> lck(this->mutex);
+						this->ready[slot] = 0;
+					}
+					this->cvFree.notify_one();
+				}
+
+				// reader thread: fill the slots in order until end of file
+				void produce() {
+					for (size_t seq = 0;; ++seq) {
+						const size_t slot = seq % this->depth;
+						{
+							std::unique_lock<std::mutex> lck(this->mutex);
+							this->cvFree.wait(lck, [&] { return this->stop || !this->ready[slot]; });
+							if (this->stop) {
+								return;
+							}
+						}
+
+						uint64_t offset = 0;
+						size_t len = 0;
+						this->plan(offset, len);
+						uint8_t* buf = this->storage.get() + slot * this->bufferSize;
+						const size_t n = this->bounded ? this->input.readAt(offset, buf, len) : this->input.read(buf, len);
+						bool end = false;
+						{
+							std::lock_guard<std::mutex> lck(this->mutex);
+							this->complete(slot, offset, len, n);
+							this->ready[slot] = 1;
+							end = this->last[slot] != 0;
+						}
+						this->cvReady.notify_one();
+						if (end) {
+							return;
+						}
+					}
+				}
+
+			#if defined(HASHPP_IO_URING)
+				// submit the read of the next part of the file into a slot
+				void submit(size_t slot) {
+					uint8_t* buf = this->storage.get() + slot * this->bufferSize;
+					uint64_t offset = 0;
+					size_t len = 0;
+					this->plan(offset, len);
+					this->offsets[slot] = offset;
+					this->expected[slot] = len;
+					if (len != 0 && !this->ringFailed && this->uring.read(this->input.native(), buf, len, offset, slot)) {
+						this->pending[slot] = 1;
+					}
+					else {
+						this->complete(slot, offset, len, this->input.readAt(offset, buf, len));
+						this->ready[slot] = 1;
+					}
+				}
+
+				// handle one completion (in any order), short reads are completed synchronously
+				bool reap() {
+					uint64_t slot = 0;
+					int res = 0;
+					if (!this->uring.wait(slot, res) || slot >= this->depth) {
+						return false;
+					}
+					uint8_t* buf = this->storage.get() + slot * this->bufferSize;
+					size_t n = res < 0 ? 0 : static_cast<size_t>(res);
+					if (n < this->expected[slot]) {
+						n += this->input.readAt(this->offsets[slot] + n, buf + n, this->expected[slot] - n);
+					}
+					this->pending[slot] = 0;
+					this->complete(slot, this->offsets[slot], this->expected[slot], n);
+					this->ready[slot] = 1;
+					return true;
+				}
+
+				// check if reads have been submitted and not completed yet
+				bool inFlight() const noexcept {
+					return std::find(this->pending.begin(), this->pending.end(), 1) != this->pending.end();
+				}
+
+				// stop using the ring after a failure: the reads in flight can't be waited on anymore and the
+				// kernel may still write into their buffers, so the storage is given up (leaked) and replaced
+				// by a copy (the completed slots are kept), the next reads are done synchronously
+				void abandon() {
+					if (this->inFlight()) {
+						const size_t total = this->bufferSize * this->depth;
+						std::unique_ptr<uint8_t[]> copy(new uint8_t[total]);
+						std::memcpy(copy.get(), this->storage.get(), total);
+						this->storage.release();
+						this->storage = std::move(copy);
+					}
+					this->pending.assign(this->depth, 0);
+					this->ringFailed = true;
+				}
+			#endif
+
+			private:
+				file input;
+				size_t bufferSize;
+				size_t depth;
+				std::unique_ptr<uint8_t[]> storage;
+				std::vector<uint64_t> offsets;
+				std::vector<size_t> lengths;
+				std::vector<uint8_t> ready;
+				std::vector<uint8_t> last;
+
+				// consumer side
+				size_t sequence = 0;
+				uint64_t position = 0;
+				bool holding = false;
+				bool emitted = false;
+				bool finished = false;
+
+				// read planning (data extents of regular files)
+				bool bounded = false;
+				bool planned = false;
+				uint64_t size = 0;
+				uint64_t cursor = 0;
+				uint64_t extentEnd = 0;
+
+				// reader thread backend
+				std::thread producer;
+				std::mutex mutex;
+				std::condition_variable cvReady;
+				std::condition_variable cvFree;
+				bool stop = false;
+
+			#if defined(HASHPP_IO_URING)
+				// io_uring backend
+				ring uring;
+				bool useRing = false;
+				bool ringFailed = false;
+				std::vector<size_t> expected;
+				std::vector<uint8_t> pending;
+			#endif
+		};
+	}
+
 	// class containing common data and methods to be
 	// derived from by algorithm classes for common use
 	// internally
 	class common {
 		public:
+			virtual ~common() = default;
+
 			// helper functions to rotate left
 			constexpr uint32_t rl32(uint32_t x, uint32_t y) noexcept {
 				return (x << y) | (x >> (32 - y));
@@ -150,23 +847,61 @@ namespace hashpp {
 			}
 
 			// get hexadecimal hash from file
-			std::string getHash(const std::filesystem::path& path) {
-				std::ifstream file(path, std::ios::binary);
-				std::vector<char> buf(1024 * 1024, 0);
+			// the next reads are kept in flight while the current buffer is hashed,
+			// returns an empty string on a read error or when cancelled through options.cancel
+			std::string getHash(const std::filesystem::path& path, const hashpp::io::fileOptions& options = {}) {
+				hashpp::io::reader reader(path, options);
+				const uint8_t* data = nullptr;
+				size_t len = 0;
+				uint64_t processed = 0;
+				uint64_t reported = 0;
 
 				this->ctx_init();
-				while (file) {
-					file.read(buf.data(), buf.size());
-					this->ctx_update(reinterpret_cast<uint8_t*>(buf.data()), file.gcount());
+				while (reader.next(data, len)) {
+					if (options.cancel && options.cancel->load(std::memory_order_relaxed)) {
+						return {};
+					}
+					this->ctx_update(data, len);
+					processed += len;
+					if (options.progress && processed - reported >= options.progressGranularity) {
+						reported = processed;
+						options.progress(processed);
+					}
+				}
+				if (reader.failed() || (options.cancel && options.cancel->load(std::memory_order_relaxed))) {
+					return {};
+				}
+				if (options.progress && (processed != reported || processed == 0)) {
+					options.progress(processed);
 				}
 				this->ctx_final();
 
 				return this->bytesToHexString();
 			}
 
+			// incremental interface: init(), then update() with the data as it comes
+			// and finalize() to get the hexadecimal hash
+			void init() { this->ctx_init(); }
+			void update(const uint8_t* data, size_t len) { this->ctx_update(data, len); }
+			std::string finalize() {
+				this->ctx_final();
+				return this->bytesToHexString();
+			}
+
+			// finalize and write the binary digest (digestSize() bytes) into out
+			void finalize(uint8_t* out) {
+				this->ctx_final();
+				std::memcpy(out, this->getDigest(), this->getDigestSize());
+			}
+
+			// size in bytes of the binary digest
+			size_t digestSize() const noexcept { return this->getDigestSize(); }
+
 		protected:
 			// virtual functions to be overridden by each algorithm implementation.
 			virtual std::vector<uint8_t> getBytes() = 0;
+			virtual const uint8_t* getDigest() const noexcept = 0;
+			virtual size_t getDigestSize() const noexcept = 0;
 			virtual void ctx_init() = 0;
 			virtual void ctx_update(const uint8_t*, size_t) = 0;
 			virtual void ctx_final() = 0;	
@@ -191,6 +926,12 @@ namespace hashpp {
 				std::vector<uint8_t> getBytes() override {
 					return std::vector<uint8_t>(context.digest, context.digest + 16);
 				}
+				const uint8_t* getDigest() const noexcept override {
+					return context.digest;
+				}
+				size_t getDigestSize() const noexcept override {
+					return 16;
+				}
 
 			// private members
 			private:
@@ -263,6 +1004,12 @@ namespace hashpp {
 				std::vector<uint8_t> getBytes() override {
 					return std::vector<uint8_t>(context.digest, context.digest + 16);
 				}
+				const uint8_t* getDigest() const noexcept override {
+					return context.digest;
+				}
+				size_t getDigestSize() const noexcept override {
+					return 16;
+				}
 
 			// private members
 			private:
@@ -335,6 +1082,12 @@ namespace hashpp {
 				std::vector<uint8_t> getBytes() override {
 					return std::vector<uint8_t>(context.digest, context.digest + 16);
 				}
+				const uint8_t* getDigest() const noexcept override {
+					return context.digest;
+				}
+				size_t getDigestSize() const noexcept override {
+					return 16;
+				}
 
 			// private members
 			private:
@@ -446,7 +1199,7 @@ namespace hashpp {
 			uint32_t offset = this->context.size % 64;
 			uint32_t plen = offset < 56 ? 56 - offset : (56 + 64) - offset;
 
-			this->ctx_update(this->pad._Elems, plen);
+			this->ctx_update(this->pad.data(), plen);
 			this->context.size -= static_cast<uint64_t>(plen);
 
 			for (uint32_t j = 0; j < 14; ++j) {
@@ -538,7 +1291,7 @@ namespace hashpp {
 			uint32_t input[16];
 			uint32_t offset = this->context.size % 64, plen = offset < 56 ? 56 - offset : (56 + 64) - offset;
 
-			this->ctx_update(this->pad._Elems, plen);
+			this->ctx_update(this->pad.data(), plen);
 			this->context.size -= static_cast<uint64_t>(plen);
 
 			for (uint32_t j = 0; j < 14; ++j) {
@@ -649,6 +1402,12 @@ namespace hashpp {
 				std::vector<uint8_t> getBytes() override {
 					return std::vector<uint8_t>(context.digest, context.digest + 20);
 				}
+				const uint8_t* getDigest() const noexcept override {
+					return context.digest;
+				}
+				size_t getDigestSize() const noexcept override {
+					return 20;
+				}
 
 			private:
 				typedef struct {
@@ -697,6 +1456,12 @@ namespace hashpp {
 				std::vector<uint8_t> getBytes() override {
 					return std::vector<uint8_t>(context.digest, context.digest + 28);
 				}
+				const uint8_t* getDigest() const noexcept override {
+					return context.digest;
+				}
+				size_t getDigestSize() const noexcept override {
+					return 28;
+				}
 
 			private:
 				typedef struct {
@@ -761,6 +1526,12 @@ namespace hashpp {
 				std::vector<uint8_t> getBytes() override {
 					return std::vector<uint8_t>(context.digest, context.digest + 32);
 				}
+				const uint8_t* getDigest() const noexcept override {
+					return context.digest;
+				}
+				size_t getDigestSize() const noexcept override {
+					return 32;
+				}
 
 			private:
 				typedef struct {
@@ -825,6 +1596,12 @@ namespace hashpp {
 				std::vector<uint8_t> getBytes() override {
 					return std::vector<uint8_t>(context.digest, context.digest + 48);
 				}
+				const uint8_t* getDigest() const noexcept override {
+					return context.digest;
+				}
+				size_t getDigestSize() const noexcept override {
+					return 48;
+				}
 
 			private:
 				typedef struct {
@@ -891,6 +1668,12 @@ namespace hashpp {
 				std::vector<uint8_t> getBytes() override {
 					return std::vector<uint8_t>(context.digest, context.digest + 64);
 				}
+				const uint8_t* getDigest() const noexcept override {
+					return context.digest;
+				}
+				size_t getDigestSize() const noexcept override {
+					return 64;
+				}
 
 			private:
 				typedef struct {
@@ -957,6 +1740,12 @@ namespace hashpp {
 				std::vector<uint8_t> getBytes() override {
 					return std::vector<uint8_t>(context.digest, context.digest + 28);
 				}
+				const uint8_t* getDigest() const noexcept override {
+					return context.digest;
+				}
+				size_t getDigestSize() const noexcept override {
+					return 28;
+				}
 
 			private:
 				typedef struct {
@@ -1023,6 +1812,12 @@ namespace hashpp {
 				std::vector<uint8_t> getBytes() override {
 					return std::vector<uint8_t>(context.digest, context.digest + 32);
 				}
+				const uint8_t* getDigest() const noexcept override {
+					return context.digest;
+				}
+				size_t getDigestSize() const noexcept override {
+					return 32;
+				}
 				
 			private:
 				typedef struct {
@@ -2012,7 +2807,7 @@ namespace hashpp {
 			
 			// operator[] overload to access collections of hashpp
 			// by their specific algorithm
-			std::vector<std::string> operator[](const std::string& algoID) const {
+			const std::vector<std::string>& operator[](const std::string& algoID) const {
 				return this->getHashesFromID(algoID);
 			}
 
@@ -2032,7 +2827,7 @@ namespace hashpp {
 			
 		private:
 			std::vector<std::pair<std::string, std::vector<std::string>>> collection;
-			std::vector<std::string> getHashesFromID(const std::string& algoID) const {
+			const std::vector<std::string>& getHashesFromID(const std::string& algoID) const {
 				for (const std::pair<std::string, std::vector<std::string>>& idHashCollectionPair : this->collection) {
 					if (!idHashCollectionPair.first.compare(algoID)) {
 						return idHashCollectionPair.second;
@@ -2041,8 +2836,83 @@ namespace hashpp {
 				
 				// if no pair in collection contains requested algorithm ID
 				// just return an empty vector
-				return std::vector<std::string>();
+				static const std::vector<std::string> empty;
+				return empty;
+			}
+	};
+
+
+	// class used to store binary digests retrieved from get*Digests
+	// the digests are indexed by algorithm and stored contiguously, so
+	// accessing them doesn't copy anything
+	//
+	// for instance:
+	//   auto allDigests = hashpp::get::getDigests({ {hashpp::ALGORITHMS::MD5, {"data1", "data2"}} });
+	//   auto md5 = allDigests[hashpp::ALGORITHMS::MD5];
+	//   for (size_t i = 0; i < md5.size(); ++i) {
+	//       std::cout << md5.getString(i) << std::endl;   // or md5[i] for the raw bytes
+	//   }
+
+	class digestCollection {
+		public:
+			// read-only view over the digests of one algorithm
+			class view {
+				public:
+					view(const uint8_t* data, size_t count, size_t digestSize) noexcept :
+						ptr(data), count(count), digestBytes(digestSize) {}
+
+					size_t size() const noexcept { return this->count; }
+					bool empty() const noexcept { return this->count == 0; }
+					size_t digestSize() const noexcept { return this->digestBytes; }
+					const uint8_t* data() const noexcept { return this->ptr; }
+
+					// raw bytes of the digest i (digestSize() bytes)
+					const uint8_t* operator[](size_t i) const noexcept { return this->ptr + i * this->digestBytes; }
+
+					// hexadecimal string of the digest i
+					std::string getString(size_t i) const {
+						static const char* hex = "0123456789abcdef";
+						std::string str(this->digestBytes * 2, '0');
+						const uint8_t* digest = this->operator[](i);
+						for (size_t j = 0; j < this->digestBytes; ++j) {
+							str[2 * j] = hex[digest[j] >> 4];
+							str[2 * j + 1] = hex[digest[j] & 0x0f];
+						}
+						return str;
+					}
+
+				private:
+					const uint8_t* ptr;
+					size_t count;
+					size_t digestBytes;
+			};
+
+			digestCollection() noexcept = default;
+
+			// access the digests of an algorithm
+			view operator[](hashpp::ALGORITHMS algorithm) const noexcept {
+				const size_t size = hashpp::digestSize(algorithm);
+				const std::vector<uint8_t>& digests = this->storage[static_cast<uint8_t>(algorithm)];
+				return view(digests.data(), size ? digests.size() / size : 0, size);
+			}
+
+			// function used to check if there are any digests in the collection under the requested algorithm
+			bool valid(hashpp::ALGORITHMS algorithm) const noexcept { return !this->operator[](algorithm).empty(); }
+
+			// reserve room for count digests of an algorithm
+			void reserve(hashpp::ALGORITHMS algorithm, size_t count) {
+				this->storage[static_cast<uint8_t>(algorithm)].reserve(count * hashpp::digestSize(algorithm));
+			}
+
+			// append one digest to an algorithm and return where its digestSize() bytes must be written
+			uint8_t* append(hashpp::ALGORITHMS algorithm) {
+				std::vector<uint8_t>& digests = this->storage[static_cast<uint8_t>(algorithm)];
+				digests.resize(digests.size() + hashpp::digestSize(algorithm));
+				return digests.data() + digests.size() - hashpp::digestSize(algorithm);
 			}
+
+		private:
+			std::array<std::vector<uint8_t>, hashpp::algorithmCount> storage;
 	};
 
 
@@ -2067,6 +2937,23 @@ namespace hashpp {
 
 	class get {
 		public:
+			// function to return a new hasher for the selected ALGORITHM (to be used with its incremental interface)
+			static std::unique_ptr<hashpp::common> getHasher(hashpp::ALGORITHMS algorithm) {
+				switch (algorithm) {
+					case hashpp::ALGORITHMS::MD5: return std::make_unique<hashpp::MD::MD5>();
+					case hashpp::ALGORITHMS::MD4: return std::make_unique<hashpp::MD::MD4>();
+					case hashpp::ALGORITHMS::MD2: return std::make_unique<hashpp::MD::MD2>();
+					case hashpp::ALGORITHMS::SHA1: return std::make_unique<hashpp::SHA::SHA1>();
+					case hashpp::ALGORITHMS::SHA2_224: return std::make_unique<hashpp::SHA::SHA2_224>();
+					case hashpp::ALGORITHMS::SHA2_256: return std::make_unique<hashpp::SHA::SHA2_256>();
+					case hashpp::ALGORITHMS::SHA2_384: return std::make_unique<hashpp::SHA::SHA2_384>();
+					case hashpp::ALGORITHMS::SHA2_512: return std::make_unique<hashpp::SHA::SHA2_512>();
+					case hashpp::ALGORITHMS::SHA2_512_224: return std::make_unique<hashpp::SHA::SHA2_512_224>();
+					case hashpp::ALGORITHMS::SHA2_512_256: return std::make_unique<hashpp::SHA::SHA2_512_256>();
+					default: return nullptr;
+				}
+			}
+
 			// function to return a resulting hash from selected ALGORITHM and passed data
 			static hashpp::hash getHash(hashpp::ALGORITHMS algorithm, const std::string& data) {
 				switch (algorithm) {
@@ -2172,39 +3059,114 @@ namespace hashpp {
 				};
 			}
 
-			// function to return a resulting hash from selected ALGORITHM and passed file
-			static hashpp::hash getFileHash(hashpp::ALGORITHMS algorithm, const std::string& path) {
+			// function to hash a batch of inputs without any allocation:
+			//   - the inputs are stored contiguously in arena, input i being [offsets[i], offsets[i + 1])
+			//     (offsets holds count + 1 entries)
+			//   - the binary digest of input i is written at digests + i * hashpp::digestSize(algorithm)
+			static void getHashesBatch(hashpp::ALGORITHMS algorithm, const uint8_t* arena, const size_t* offsets, size_t count, uint8_t* digests) {
+				switch (algorithm) {
+					case hashpp::ALGORITHMS::MD5: return hashBatch<hashpp::MD::MD5>(arena, offsets, count, digests);
+					case hashpp::ALGORITHMS::MD4: return hashBatch<hashpp::MD::MD4>(arena, offsets, count, digests);
+					case hashpp::ALGORITHMS::MD2: return hashBatch<hashpp::MD::MD2>(arena, offsets, count, digests);
+					case hashpp::ALGORITHMS::SHA1: return hashBatch<hashpp::SHA::SHA1>(arena, offsets, count, digests);
+					case hashpp::ALGORITHMS::SHA2_224: return hashBatch<hashpp::SHA::SHA2_224>(arena, offsets, count, digests);
+					case hashpp::ALGORITHMS::SHA2_256: return hashBatch<hashpp::SHA::SHA2_256>(arena, offsets, count, digests);
+					case hashpp::ALGORITHMS::SHA2_384: return hashBatch<hashpp::SHA::SHA2_384>(arena, offsets, count, digests);
+					case hashpp::ALGORITHMS::SHA2_512: return hashBatch<hashpp::SHA::SHA2_512>(arena, offsets, count, digests);
+					case hashpp::ALGORITHMS::SHA2_512_224: return hashBatch<hashpp::SHA::SHA2_512_224>(arena, offsets, count, digests);
+					case hashpp::ALGORITHMS::SHA2_512_256: return hashBatch<hashpp::SHA::SHA2_512_256>(arena, offsets, count, digests);
+					default: return;
+				}
+			}
+
+			// function to return a collection of binary digests from selected ALGORITHMS and passed data
+			static hashpp::digestCollection getDigests(const std::vector<std::pair<hashpp::ALGORITHMS, std::vector<std::string>>>& algorithmDataPairs) {
+				hashpp::digestCollection digests;
+				for (const std::pair<hashpp::ALGORITHMS, std::vector<std::string>>& twin : algorithmDataPairs) {
+					std::unique_ptr<hashpp::common> hasher = getHasher(twin.first);
+					if (!hasher) {
+						continue;
+					}
+					digests.reserve(twin.first, digests[twin.first].size() + twin.second.size());
+					for (const std::string& _data : twin.second) {
+						hasher->init();
+						hasher->update(reinterpret_cast<const uint8_t*>(_data.data()), _data.size());
+						hasher->finalize(digests.append(twin.first));
+					}
+				}
+				return digests;
+			}
+
+			// function to return a collection of binary digests from selected ALGORITHMS and passed files (with recursive directory support)
+			static hashpp::digestCollection getFilesDigests(const std::vector<std::pair<hashpp::ALGORITHMS, std::vector<std::string>>>& algorithmPathPairs) {
+				hashpp::digestCollection digests;
+				for (const std::pair<hashpp::ALGORITHMS, std::vector<std::string>>& twin : algorithmPathPairs) {
+					std::unique_ptr<hashpp::common> hasher = getHasher(twin.first);
+					if (!hasher) {
+						continue;
+					}
+					const auto hashFile = [&](const std::filesystem::path& path) {
+						hashpp::io::reader reader(path);
+						const uint8_t* data = nullptr;
+						size_t len = 0;
+						hasher->init();
+						while (reader.next(data, len)) {
+							hasher->update(data, len);
+						}
+						if (!reader.failed()) {
+							hasher->finalize(digests.append(twin.first));
+						}
+					};
+					for (const std::string& _path : twin.second) {
+						if (std::filesystem::exists(_path) && std::filesystem::is_regular_file(_path)) {
+							hashFile(_path);
+						}
+						else if (std::filesystem::exists(_path) && std::filesystem::is_directory(_path)) {
+							for (const std::filesystem::directory_entry& item : std::filesystem::recursive_directory_iterator(_path)) {
+								if (item.is_regular_file()) {
+									hashFile(item.path());
+								}
+							}
+						}
+					}
+				}
+				return digests;
+			}
+
+			// function to return a resulting hash from selected ALGORITHM and passed file,
+			// the options allow to follow the progress and to cancel it (invalid hash)
+			static hashpp::hash getFileHash(hashpp::ALGORITHMS algorithm, const std::string& path, const hashpp::io::fileOptions& options = {}) {
 				if (std::filesystem::exists(path) && std::filesystem::is_regular_file(path)) {
 					switch (algorithm) {
 						case hashpp::ALGORITHMS::MD5: {
-							return { hashpp::MD::MD5().getHash(std::filesystem::path(path)) };
+							return { hashpp::MD::MD5().getHash(std::filesystem::path(path), options) };
 						}
 						case hashpp::ALGORITHMS::MD4: {
-							return { hashpp::MD::MD4().getHash(std::filesystem::path(path)) };
+							return { hashpp::MD::MD4().getHash(std::filesystem::path(path), options) };
 						}
 						case hashpp::ALGORITHMS::MD2: {
-							return { hashpp::MD::MD2().getHash(std::filesystem::path(path)) };
+							return { hashpp::MD::MD2().getHash(std::filesystem::path(path), options) };
 						}
 						case hashpp::ALGORITHMS::SHA1: {
-							return { hashpp::SHA::SHA1().getHash(std::filesystem::path(path)) };
+							return { hashpp::SHA::SHA1().getHash(std::filesystem::path(path), options) };
 						}
 						case hashpp::ALGORITHMS::SHA2_224: {
-							return { hashpp::SHA::SHA2_224().getHash(std::filesystem::path(path)) };
+							return { hashpp::SHA::SHA2_224().getHash(std::filesystem::path(path), options) };
 						}
 						case hashpp::ALGORITHMS::SHA2_256: {
-							return { hashpp::SHA::SHA2_256().getHash(std::filesystem::path(path)) };
+							return { hashpp::SHA::SHA2_256().getHash(std::filesystem::path(path), options) };
 						}
 						case hashpp::ALGORITHMS::SHA2_384: {
-							return { hashpp::SHA::SHA2_384().getHash(std::filesystem::path(path)) };
+							return { hashpp::SHA::SHA2_384().getHash(std::filesystem::path(path), options) };
 						}
 						case hashpp::ALGORITHMS::SHA2_512: {
-							return { hashpp::SHA::SHA2_512().getHash(std::filesystem::path(path)) };
+							return { hashpp::SHA::SHA2_512().getHash(std::filesystem::path(path), options) };
 						}
 						case hashpp::ALGORITHMS::SHA2_512_224: {
-							return { hashpp::SHA::SHA2_512_224().getHash(std::filesystem::path(path)) };
+							return { hashpp::SHA::SHA2_512_224().getHash(std::filesystem::path(path), options) };
 						}
 						case hashpp::ALGORITHMS::SHA2_512_256: {
-							return { hashpp::SHA::SHA2_512_256().getHash(std::filesystem::path(path)) };
+							return { hashpp::SHA::SHA2_512_256().getHash(std::filesystem::path(path), options) };
 						}
 						default: {
 							return hashpp::hash();
@@ -2331,108 +3293,526 @@ namespace hashpp {
 					}
 				};
 		}
+
+		private:
+			// hash each input of a batch with one hasher living on the stack
+			template <class _Ty>
+			static void hashBatch(const uint8_t* arena, const size_t* offsets, size_t count, uint8_t* digests) {
+				_Ty hasher;
+				const size_t size = hasher.digestSize();
+				for (size_t i = 0; i < count; ++i) {
+					hasher.init();
+					hasher.update(arena + offsets[i], offsets[i + 1] - offsets[i]);
+					hasher.finalize(digests + i * size);
+				}
+			}
 	};
 
-	#if defined(HASHPP_INCLUDE_METRICS)
-	// well-defined timer class for use in metrics
-	template <class _Ty>
-	class timer {
-		public:
-			void startTimer() {
-				this->_start = std::chrono::high_resolution_clock::now();
+	// context triggered piecewise hashing (ssdeep style) used to find near-duplicates:
+	// the data is cut where a rolling hash over a small window hits a trigger value and
+	// each piece contributes one character to the signature, so a local change of the
+	// data only changes a few characters of the signature
+	//
+	// a fuzzy hash is "blockSize:first:second", first being the signature for the
+	// block size and second for twice the block size, two hashes can only be compared
+	// when their block sizes are equal or differ by a factor of two
+	namespace fuzzy {
+		// maximum length of the first signature (the second one is half of it)
+		constexpr size_t signatureLength = 64;
+		constexpr uint32_t minBlockSize = 3;
+		constexpr size_t rollingWindow = 7;
+		constexpr size_t blockHashes = 31;
+
+		// fuzzy hash: block size and the two signatures
+		class hash {
+			public:
+				hash() noexcept = default;
+				hash(uint32_t blockSize, std::string first, std::string second) noexcept :
+					size(blockSize), sig1(std::move(first)), sig2(std::move(second)) {}
+
+				// parse a "blockSize:first:second" string (invalid hash on error)
+				explicit hash(const std::string& str) {
+					const size_t a = str.find(':');
+					const size_t b = a == std::string::npos ? a : str.find(':', a + 1);
+					if (a == 0 || b == std::string::npos || str.find_first_not_of("0123456789") != a) {
+						return;
+					}
+					unsigned long long value = 0;
+					try {
+						value = std::stoull(str.substr(0, a));
+					}
+					catch (const std::exception&) {
+						return;
+					}
+					if (value > static_cast<uint32_t>(-1)) {
+						return;
+					}
+					this->size = static_cast<uint32_t>(value);
+					this->sig1 = str.substr(a + 1, b - a - 1);
+					this->sig2 = str.substr(b + 1);
+				}
+
+				bool valid() const noexcept { return this->size != 0; }
+				uint32_t blockSize() const noexcept { return this->size; }
+				const std::string& first() const noexcept { return this->sig1; }
+				const std::string& second() const noexcept { return this->sig2; }
+				std::string getString() const {
+					return this->valid() ? std::to_string(this->size) + ":" + this->sig1 + ":" + this->sig2 : std::string();
+				}
+
+				bool operator==(const hash& _rhs) const noexcept {
+					return this->size == _rhs.size && this->sig1 == _rhs.sig1 && this->sig2 == _rhs.sig2;
+				}
+				friend std::ostream& operator<<(std::ostream& _Ostr, const hashpp::fuzzy::hash& object) {
+					_Ostr << object.getString();
+					return _Ostr;
+				}
+
+			private:
+				uint32_t size = 0;
+				std::string sig1;
+				std::string sig2;
+		};
+
+		// incremental fuzzy hashing: the signatures of all the block sizes which may
+		// be selected at the end are computed together, in a single pass
+		class context {
+			public:
+				context() noexcept { this->reset(); }
+
+				void reset() noexcept {
+					this->window.fill(0);
+					this->h1 = this->h2 = this->h3 = 0;
+					this->n = 0;
+					this->total = 0;
+					this->start = 0;
+					this->end = 1;
+					this->blocks[0] = block();
+				}
+
+				void update(const uint8_t* data, size_t len) noexcept {
+					for (size_t i = 0; i < len; ++i) {
+						this->step(data[i]);
+					}
+				}
+
+				hashpp::fuzzy::hash finalize() const {
+					// smallest block size giving a signature not longer than signatureLength
+					size_t bi = this->start;
+					while (bi + 1 < this->end && blockSize(bi) * signatureLength < this->total) {
+						++bi;
+					}
+					// too short signatures carry no information: take smaller blocks
+					while (bi > this->start && this->blocks[bi].length < signatureLength / 2) {
+						--bi;
+					}
+
+					const uint32_t roll = this->rollSum();
+					const block& b1 = this->blocks[bi];
+					std::string sig1(b1.digest.data(), b1.length);
+					if (roll != 0) {
+						sig1 += base64[b1.h % 64];
+					}
+					else if (b1.last) {
+						sig1 += b1.last;
+					}
+
+					std::string sig2;
+					if (bi + 1 < this->end) {
+						const block& b2 = this->blocks[bi + 1];
+						sig2.assign(b2.digest.data(), (std::min)(b2.length, signatureLength / 2 - 1));
+						if (roll != 0) {
+							sig2 += base64[b2.halfH % 64];
+						}
+						else if (b2.halfLast) {
+							sig2 += b2.halfLast;
+						}
+					}
+					else if (roll != 0) {
+						sig2 += base64[b1.h % 64];
+					}
+					return { blockSize(bi), std::move(sig1), std::move(sig2) };
+				}
+
+			private:
+				static constexpr uint32_t hashInit = 0x28021967;
+				static constexpr uint32_t hashPrime = 0x01000193;
+				static constexpr const char* base64 = "ABCDEFGHIJKLMNOPQRSTUVWXYZabcdefghijklmnopqrstuvwxyz0123456789+/";
+
+				// signature in progress for one block size
+				struct block {
+					uint32_t h = hashInit;
+					uint32_t halfH = hashInit;
+					std::array<char, signatureLength> digest = {};
+					size_t length = 0;
+					char last = 0;
+					char halfLast = 0;
+				};
+
+				static constexpr uint32_t blockSize(size_t i) noexcept { return minBlockSize << i; }
+				uint32_t rollSum() const noexcept { return this->h1 + this->h2 + this->h3; }
+
+				void step(uint8_t c) noexcept {
+					// rolling hash over the last rollingWindow bytes
+					this->h2 -= this->h1;
+					this->h2 += static_cast<uint32_t>(rollingWindow) * c;
+					this->h1 += c;
+					this->h1 -= this->window[this->n % rollingWindow];
+					this->window[this->n % rollingWindow] = c;
+					++this->n;
+					++this->total;
+					this->h3 = (this->h3 << 5) ^ c;
+					const uint32_t roll = this->rollSum();
+
+					for (size_t i = this->start; i < this->end; ++i) {
+						this->blocks[i].h = (this->blocks[i].h * hashPrime) ^ c;
+						this->blocks[i].halfH = (this->blocks[i].halfH * hashPrime) ^ c;
+					}
+					// every trigger of a block size is also a trigger of the smaller ones
+					if (roll % minBlockSize != minBlockSize - 1) {
+						return;
+					}
+					for (size_t i = this->start; i < this->end; ++i) {
+						if (roll % blockSize(i) != blockSize(i) - 1) {
+							break;
+						}
+						block& b = this->blocks[i];
+						// first piece of the largest block size: start the next one
+						if (b.length == 0 && i + 1 == this->end && this->end < blockHashes) {
+							this->blocks[this->end] = b;
+							++this->end;
+						}
+						const char ch = base64[b.h % 64];
+						if (b.length < signatureLength - 1) {
+							b.digest[b.length++] = ch;
+							b.h = hashInit;
+							if (b.length < signatureLength / 2) {
+								b.halfH = hashInit;
+								b.halfLast = 0;
+							}
+							else {
+								b.halfLast = base64[b.halfH % 64];
+							}
+						}
+						else {
+							// signature full: keep only the last piece and drop the smallest block size
+							// as soon as the next one is long enough to replace it
+							b.last = ch;
+							b.halfLast = base64[b.halfH % 64];
+							if (i == this->start && this->end - this->start > 1 &&
+							    static_cast<uint64_t>(blockSize(i)) * signatureLength < this->total &&
+							    this->blocks[i + 1].length >= signatureLength / 2) {
+								++this->start;
+							}
+						}
+					}
+				}
+
+			private:
+				std::array<uint8_t, rollingWindow> window;
+				uint32_t h1 = 0, h2 = 0, h3 = 0;
+				uint32_t n = 0;
+				uint64_t total = 0;
+				size_t start = 0;
+				size_t end = 1;
+				std::array<block, blockHashes> blocks;
+		};
+
+		// get the fuzzy hash of data
+		inline hashpp::fuzzy::hash getHash(const uint8_t* data, size_t len) {
+			context ctx;
+			ctx.update(data, len);
+			return ctx.finalize();
+		}
+		inline hashpp::fuzzy::hash getHash(const std::string& data) {
+			return getHash(reinterpret_cast<const uint8_t*>(data.data()), data.size());
+		}
+
+		// get the fuzzy hash of a file (invalid hash if the file doesn't exist, can't be read or when cancelled)
+		inline hashpp::fuzzy::hash getFileHash(const std::filesystem::path& path, const hashpp::io::fileOptions& options = {}) {
+			if (!std::filesystem::is_regular_file(path)) {
+				return {};
+			}
+			hashpp::io::reader reader(path, options);
+			const uint8_t* data = nullptr;
+			size_t len = 0;
+			context ctx;
+			while (reader.next(data, len)) {
+				if (options.cancel && options.cancel->load(std::memory_order_relaxed)) {
+					return {};
+				}
+				ctx.update(data, len);
 			}
-			
-			void stopTimer() {
-				this->_end = std::chrono::high_resolution_clock::now();
+			if (reader.failed()) {
+				return {};
 			}
-			
-			constexpr _Ty getTime() const {
-				return std::chrono::duration_cast<_Ty>(this->_end - this->_start);
+			return ctx.finalize();
+		}
+
+		namespace details {
+			// collapse the runs of more than 3 identical characters, they carry little information
+			inline std::string eliminateSequences(const std::string& str) {
+				std::string out;
+				out.reserve(str.size());
+				for (size_t i = 0; i < str.size(); ++i) {
+					if (i < 3 || str[i] != str[i - 1] || str[i] != str[i - 2] || str[i] != str[i - 3]) {
+						out += str[i];
+					}
+				}
+				return out;
 			}
-			
-		private:
-			std::chrono::steady_clock::time_point _start;
-			std::chrono::steady_clock::time_point _end;
-	};
-	
-	template <bool IncludeMD2 = true, class _Ty = std::chrono::milliseconds>
-	class metrics : private timer<_Ty> { // optional class for algorithm metrics and benchmarking
-		public:
-			// Function to check each algorithm for correctness
-			void checkAlgorithms() const {
-				for (const hashpp::ALGORITHMS& algorithm : this->algorithms) {
-					if (hashpp::get::getHash(algorithm, "d").getString() == this->comparisons[static_cast<uint8_t>(algorithm)].first) {
-						std::cout << this->comparisons[static_cast<uint8_t>(algorithm)].second << " pass." << std::endl;
+
+			// hash of each window of rollingWindow characters of a signature
+			inline std::vector<uint64_t> windows(const std::string& str) {
+				std::vector<uint64_t> keys;
+				for (size_t i = 0; i + rollingWindow <= str.size(); ++i) {
+					uint64_t key = 0;
+					for (size_t j = 0; j < rollingWindow; ++j) {
+						key = (key << 8) | static_cast<uint8_t>(str[i + j]);
 					}
-					else {
-						std::cout << this->comparisons[static_cast<uint8_t>(algorithm)].second << " fail." << std::endl;
+					keys.push_back(key);
+				}
+				return keys;
+			}
+
+			// signatures are only related if they share at least one window
+			inline bool hasCommonWindow(const std::string& s1, const std::string& s2) {
+				if (s1.size() < rollingWindow || s2.size() < rollingWindow) {
+					return false;
+				}
+				std::vector<uint64_t> k1 = windows(s1);
+				std::sort(k1.begin(), k1.end());
+				for (const uint64_t key : windows(s2)) {
+					if (std::binary_search(k1.begin(), k1.end(), key)) {
+						return true;
 					}
 				}
+				return false;
 			}
 
-			// Function to measure performance of all hashing algorithms when hashing 10 million
-			// repetitions of argument 'target.'
-			void benchmarkAlgorithms(const std::string& target) {
-				std::cout << "Testing 10m hashing repetitions of '" << target << "'.\n" << std::endl;
-				for (const hashpp::ALGORITHMS& algorithm : this->algorithms) {
-					if (algorithm == hashpp::ALGORITHMS::MD2 && !IncludeMD2) {
-						continue;
+			// edit distance with insertions and deletions costing 1 and substitutions 2
+			inline size_t editDistance(const std::string& s1, const std::string& s2) {
+				std::array<size_t, signatureLength + 1> prev, cur;
+				for (size_t j = 0; j <= s2.size(); ++j) {
+					prev[j] = j;
+				}
+				for (size_t i = 1; i <= s1.size(); ++i) {
+					cur[0] = i;
+					for (size_t j = 1; j <= s2.size(); ++j) {
+						const size_t sub = prev[j - 1] + (s1[i - 1] == s2[j - 1] ? 0 : 2);
+						cur[j] = (std::min)({ prev[j] + 1, cur[j - 1] + 1, sub });
 					}
-					else {
-						this->startTimer();
-						for (uint32_t i = 0; i < 10000000; i++) {
-							hashpp::get::getHash(algorithm, target);
+					std::swap(prev, cur);
+				}
+				return prev[s2.size()];
+			}
+
+			// score (0-100) of two signatures computed with the same block size
+			inline uint32_t scoreSignatures(const std::string& s1, const std::string& s2, uint32_t blockSize) {
+				if (s1.size() > signatureLength || s2.size() > signatureLength || !hasCommonWindow(s1, s2)) {
+					return 0;
+				}
+				size_t score = editDistance(s1, s2);
+				score = (score * signatureLength) / (s1.size() + s2.size());
+				score = (100 * score) / signatureLength;
+				if (score >= 100) {
+					return 0;
+				}
+				score = 100 - score;
+				// small block sizes: don't report a match better than the signatures can tell
+				if (blockSize < (99 + rollingWindow) / rollingWindow * minBlockSize) {
+					score = (std::min)(score, static_cast<size_t>(blockSize / minBlockSize) * (std::min)(s1.size(), s2.size()));
+				}
+				return static_cast<uint32_t>(score);
+			}
+
+			// compare two hashes whose sequences have been eliminated already
+			inline uint32_t compareEliminated(uint32_t bs1, const std::string& a1, const std::string& a2,
+			                                  uint32_t bs2, const std::string& b1, const std::string& b2) {
+				if (bs1 == bs2) {
+					if (a1 == b1 && a2 == b2) {
+						return 100;
+					}
+					return (std::max)(scoreSignatures(a1, b1, bs1), scoreSignatures(a2, b2, bs1 * 2));
+				}
+				if (bs1 == bs2 * 2) {
+					return scoreSignatures(a1, b2, bs1);
+				}
+				if (bs2 == bs1 * 2) {
+					return scoreSignatures(a2, b1, bs2);
+				}
+				return 0;
+			}
+		}
+
+		// similarity score of two fuzzy hashes: 0 (unrelated) to 100 (identical)
+		inline uint32_t compare(const hashpp::fuzzy::hash& a, const hashpp::fuzzy::hash& b) {
+			if (!a.valid() || !b.valid()) {
+				return 0;
+			}
+			return details::compareEliminated(a.blockSize(), details::eliminateSequences(a.first()), details::eliminateSequences(a.second()),
+			                                  b.blockSize(), details::eliminateSequences(b.first()), details::eliminateSequences(b.second()));
+		}
+
+		// pair of hashes (indexes) found similar by the batch compare
+		struct match {
+			size_t first;
+			size_t second;
+			uint32_t score;
+		};
+
+		// compare all the hashes with each other and return the pairs scoring at least 'threshold':
+		// the signatures are indexed by (block size, window) so that only the pairs sharing
+		// a window, the only ones which can score above 0, are scored
+		inline std::vector<hashpp::fuzzy::match> compare(const std::vector<hashpp::fuzzy::hash>& hashes, uint32_t threshold = 1) {
+			std::vector<std::pair<std::string, std::string>> sigs(hashes.size());
+			std::vector<std::pair<uint64_t, size_t>> index;
+			for (size_t i = 0; i < hashes.size(); ++i) {
+				if (!hashes[i].valid()) {
+					continue;
+				}
+				// identical hashes match even when their signatures are too short to share a window
+				index.emplace_back((std::hash<std::string>{}(hashes[i].getString()) | (1ull << 63)), i);
+				sigs[i] = { details::eliminateSequences(hashes[i].first()), details::eliminateSequences(hashes[i].second()) };
+				const uint64_t bs = hashes[i].blockSize();
+				for (const auto& [sig, size] : { std::make_pair(&sigs[i].first, bs), std::make_pair(&sigs[i].second, bs * 2) }) {
+					for (const uint64_t key : details::windows(*sig)) {
+						// 56 bits of window and the block size exponent make the key
+						uint64_t exponent = 0;
+						while ((static_cast<uint64_t>(minBlockSize) << exponent) < size) {
+							++exponent;
 						}
-						this->stopTimer();
-						std::cout << this->comparisons[static_cast<uint8_t>(algorithm)].second << ": " << this->getTime().count() << std::endl;
+						index.emplace_back((key ^ (exponent << 56)), i);
 					}
 				}
 			}
+			std::sort(index.begin(), index.end());
+			index.erase(std::unique(index.begin(), index.end()), index.end());
 
-			// Function to measure performance of all hashing algorithms when hashing a given file
-			void benchmarkAlgorithms_File(const std::string& path) {
-				std::cout << "Testing algorithm speeds for hashing of file '" << path << "'.\n" << std::endl;
-				for (const hashpp::ALGORITHMS& algorithm : this->algorithms) {
-					if (algorithm == hashpp::ALGORITHMS::MD2 && !IncludeMD2) {
+			// candidate pairs: hashes sharing a key
+			std::vector<std::pair<size_t, size_t>> candidates;
+			for (size_t lo = 0, hi = 0; lo < index.size(); lo = hi) {
+				while (hi < index.size() && index[hi].first == index[lo].first) {
+					++hi;
+				}
+				for (size_t x = lo; x < hi; ++x) {
+					for (size_t y = x + 1; y < hi; ++y) {
+						candidates.emplace_back(index[x].second, index[y].second);
+					}
+				}
+			}
+			std::sort(candidates.begin(), candidates.end());
+			candidates.erase(std::unique(candidates.begin(), candidates.end()), candidates.end());
+
+			std::vector<hashpp::fuzzy::match> matches;
+			for (const auto& [i, j] : candidates) {
+				const uint32_t score = details::compareEliminated(hashes[i].blockSize(), sigs[i].first, sigs[i].second,
+				                                                  hashes[j].blockSize(), sigs[j].first, sigs[j].second);
+				if (score >= threshold && score > 0) {
+					matches.push_back({ i, j, score });
+				}
+			}
+			return matches;
+		}
+	}
+
+	#if defined(HASHPP_USE_AF_ALG) && defined(__linux__)
+	// optional backend offloading file hashing to the linux kernel crypto api:
+	// the file is spliced into an AF_ALG socket so its bytes never reach userspace
+	namespace kernel {
+		// kernel crypto api name of an algorithm (nullptr if the kernel doesn't provide it)
+		inline const char* algorithmName(hashpp::ALGORITHMS algorithm) noexcept {
+			switch (algorithm) {
+				case hashpp::ALGORITHMS::MD5: return "md5";
+				case hashpp::ALGORITHMS::MD4: return "md4";
+				case hashpp::ALGORITHMS::SHA1: return "sha1";
+				case hashpp::ALGORITHMS::SHA2_224: return "sha224";
+				case hashpp::ALGORITHMS::SHA2_256: return "sha256";
+				case hashpp::ALGORITHMS::SHA2_384: return "sha384";
+				case hashpp::ALGORITHMS::SHA2_512: return "sha512";
+				default: return nullptr;
+			}
+		}
+
+		// function to return a resulting hash from selected ALGORITHM and passed file computed by the kernel,
+		// returns an invalid hash when AF_ALG or the algorithm isn't available so the caller can fall back
+		inline hashpp::hash getFileHash(hashpp::ALGORITHMS algorithm, const std::filesystem::path& path) {
+			// close all descriptors when leaving
+			struct descriptors {
+				int tfm = -1, op = -1, file = -1, pipe[2] = { -1, -1 };
+				~descriptors() {
+					for (int fd : { this->tfm, this->op, this->file, this->pipe[0], this->pipe[1] }) {
+						if (fd >= 0) {
+							::close(fd);
+						}
+					}
+				}
+			} fds;
+
+			const char* name = algorithmName(algorithm);
+			if (!name) {
+				return hashpp::hash();
+			}
+
+			// bind a transform socket to the algorithm and open an operation socket on it
+			sockaddr_alg sa;
+			std::memset(&sa, 0, sizeof(sa));
+			sa.salg_family = AF_ALG;
+			std::strcpy(reinterpret_cast<char*>(sa.salg_type), "hash");
+			std::strcpy(reinterpret_cast<char*>(sa.salg_name), name);
+			fds.tfm = ::socket(AF_ALG, SOCK_SEQPACKET | SOCK_CLOEXEC, 0);
+			if (fds.tfm < 0 || ::bind(fds.tfm, reinterpret_cast<sockaddr*>(&sa), sizeof(sa)) != 0) {
+				return hashpp::hash();
+			}
+			fds.op = ::accept4(fds.tfm, nullptr, nullptr, SOCK_CLOEXEC);
+			fds.file = ::open(path.c_str(), O_RDONLY | O_CLOEXEC);
+			if (fds.op < 0 || fds.file < 0 || ::pipe2(fds.pipe, O_CLOEXEC) != 0) {
+				return hashpp::hash();
+			}
+
+			// move the file pages through the pipe into the socket (zero-copy)
+			constexpr size_t chunk = 64 * 1024;
+			loff_t offset = 0;
+			for (;;) {
+				const ssize_t in = ::splice(fds.file, &offset, fds.pipe[1], nullptr, chunk, SPLICE_F_MOVE | SPLICE_F_MORE);
+				if (in < 0 && errno == EINTR) {
+					continue;
+				}
+				if (in < 0) {
+					return hashpp::hash();
+				}
+				if (in == 0) {
+					break;
+				}
+				for (ssize_t left = in; left > 0;) {
+					const ssize_t out = ::splice(fds.pipe[0], nullptr, fds.op, nullptr, static_cast<size_t>(left), SPLICE_F_MOVE | SPLICE_F_MORE);
+					if (out < 0 && errno == EINTR) {
 						continue;
 					}
-					else {
-						this->startTimer();
-						hashpp::get::getFileHash(algorithm, path);
-						this->stopTimer();
-						std::cout << this->comparisons[static_cast<uint8_t>(algorithm)].second << ": " << this->getTime().count() << std::endl;
+					if (out <= 0) {
+						return hashpp::hash();
 					}
+					left -= out;
 				}
 			}
 
-		private:
-			const std::vector<hashpp::ALGORITHMS> algorithms = {
-				hashpp::ALGORITHMS::MD5,
-				hashpp::ALGORITHMS::MD4,
-				hashpp::ALGORITHMS::MD2,
-				hashpp::ALGORITHMS::SHA1,
-				hashpp::ALGORITHMS::SHA2_224,
-				hashpp::ALGORITHMS::SHA2_256,
-				hashpp::ALGORITHMS::SHA2_384,
-				hashpp::ALGORITHMS::SHA2_512,
-				hashpp::ALGORITHMS::SHA2_512_224,
-				hashpp::ALGORITHMS::SHA2_512_256
-			};
+			// an empty message without MSG_MORE finalizes the hash
+			uint8_t digest[64];
+			const size_t size = hashpp::digestSize(algorithm);
+			if (::send(fds.op, nullptr, 0, 0) < 0 || ::read(fds.op, digest, size) != static_cast<ssize_t>(size)) {
+				return hashpp::hash();
+			}
 
-			// All correct hashes of data 'd' for comparison
-			const std::vector<std::pair<std::string, std::string>> comparisons = {
-				{ "8277e0910d750195b448797616e091ad", "MD5" },
-				{ "5d3f7ed29552c4ab4612fb7686bb52bb", "MD4" },
-				{ "96978c0796ce94f7beb31576946b6bed", "MD2" },
-				{ "3c363836cf4e16666669a25da280a1865c2d2874", "SHA1" },
-				{ "06c9f71496e24dec6acc44895648cf9ec40b5cebb7bc4858a3c69f25", "SHA2-224" },
-				{ "18ac3e7343f016890c510e93f935261169d9e3f565436429830faf0934f4f8e4", "SHA2-256" },
-				{ "8ac10705a78a2dcd15fa577bac70762708597a02e130d8a6192d73dababd2b14502dbeee29d0e22bc341a0c42af6a4fb", "SHA2-384" },
-				{ "48fb10b15f3d44a09dc82d02b06581e0c0c69478c9fd2cf8f9093659019a1687baecdbb38c9e72b12169dc4148690f87467f9154f5931c5df665c6496cbfd5f5", "SHA2-512" },
-				{ "a8c9aa3f45f2ada72e3ae9278407b4ade221490596c69b27af611dae", "SHA2-512/224" },
-				{ "9a895196448c0a9daa9769b48f29db5b41cfe2f6f65943a8ef2b8f446e388f7e", "SHA2-512/256" }
-			};
-	};
+			static const char* hex = "0123456789abcdef";
+			std::string str;
+			str.reserve(size * 2);
+			for (size_t i = 0; i < size; ++i) {
+				str += hex[digest[i] >> 4];
+				str += hex[digest[i] & 0x0f];
+			}
+			return { std::move(str) };
+		}
+	}
 	#endif
 }
 
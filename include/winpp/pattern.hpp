@@ -0,0 +1,662 @@
+#pragma once
+#include <string>
+#include <string_view>
+#include <vector>
+#include <array>
+#include <map>
+#include <bitset>
+#include <cctype>
+#include <cstdint>
+#include <algorithm>
+#include <filesystem>
+#include <type_traits>
+#include <fmt/format.h>
+
+namespace files
+{
+  // maximum number of states of a compiled pattern
+  constexpr std::size_t max_pattern_states = 4096;
+
+  namespace details
+  {
+    using byte_set = std::bitset<256>;
+
+    // thompson automaton built by the pattern parsers
+    class nfa final
+    {
+    public:
+      enum accept_type : uint8_t { none = 0, anywhere = 1, at_end = 2 };
+
+      struct state
+      {
+        byte_set bytes;             // bytes leading to next
+        int next = -1;
+        std::vector<int> epsilon;   // transitions without input
+        accept_type accept = none;
+      };
+
+      // sub-automaton: the end state has no transition yet
+      struct fragment
+      {
+        int start;
+        int end;
+      };
+
+      int add()
+      {
+        m_states.emplace_back();
+        return static_cast<int>(m_states.size() - 1);
+      }
+
+      fragment empty()
+      {
+        const int s = add();
+        return { s, s };
+      }
+
+      fragment bytes(const byte_set& set)
+      {
+        const int s = add();
+        const int e = add();
+        m_states[s].bytes = set;
+        m_states[s].next = e;
+        return { s, e };
+      }
+
+      fragment concat(const fragment& a, const fragment& b)
+      {
+        m_states[a.end].epsilon.push_back(b.start);
+        return { a.start, b.end };
+      }
+
+      fragment alternate(const fragment& a, const fragment& b)
+      {
+        const int s = add();
+        const int e = add();
+        m_states[s].epsilon = { a.start, b.start };
+        m_states[a.end].epsilon.push_back(e);
+        m_states[b.end].epsilon.push_back(e);
+        return { s, e };
+      }
+
+      fragment star(const fragment& a)
+      {
+        const int s = add();
+        const int e = add();
+        m_states[s].epsilon = { a.start, e };
+        m_states[a.end].epsilon.push_back(a.start);
+        m_states[a.end].epsilon.push_back(e);
+        return { s, e };
+      }
+
+      fragment plus(const fragment& a)
+      {
+        const int e = add();
+        m_states[a.end].epsilon.push_back(a.start);
+        m_states[a.end].epsilon.push_back(e);
+        return { a.start, e };
+      }
+
+      fragment optional(const fragment& a)
+      {
+        const int s = add();
+        m_states[s].epsilon = { a.start, a.end };
+        return { s, a.end };
+      }
+
+      void accept(const fragment& a, const accept_type type)
+      {
+        m_states[a.end].accept = type;
+      }
+
+      std::vector<state>& states()
+      {
+        return m_states;
+      }
+
+    private:
+      std::vector<state> m_states;
+    };
+
+    // call step on each utf-8 byte of a string (the wide strings of windows paths are utf-16, encoded
+    // on the fly without allocation), returns false as soon as step returns false
+    template <typename Char, typename Step>
+    inline bool utf8_bytes(const Char* begin, const Char* end, const Step& step)
+    {
+      if constexpr (sizeof(Char) == 1)
+      {
+        for (const Char* p = begin; p != end; ++p)
+          if (!step(static_cast<unsigned char>(*p)))
+            return false;
+      }
+      else
+      {
+        for (const Char* p = begin; p != end; ++p)
+        {
+          uint32_t cp = static_cast<uint32_t>(*p);
+          if (cp >= 0xd800 && cp < 0xdc00 && p + 1 != end && static_cast<uint32_t>(p[1]) >= 0xdc00 && static_cast<uint32_t>(p[1]) < 0xe000)
+            cp = 0x10000 + ((cp - 0xd800) << 10) + (static_cast<uint32_t>(*++p) - 0xdc00);
+          bool ok = true;
+          if (cp < 0x80)
+            ok = step(static_cast<unsigned char>(cp));
+          else if (cp < 0x800)
+            ok = step(static_cast<unsigned char>(0xc0 | (cp >> 6))) && step(static_cast<unsigned char>(0x80 | (cp & 0x3f)));
+          else if (cp < 0x10000)
+            ok = step(static_cast<unsigned char>(0xe0 | (cp >> 12))) && step(static_cast<unsigned char>(0x80 | ((cp >> 6) & 0x3f))) &&
+                 step(static_cast<unsigned char>(0x80 | (cp & 0x3f)));
+          else
+            ok = step(static_cast<unsigned char>(0xf0 | (cp >> 18))) && step(static_cast<unsigned char>(0x80 | ((cp >> 12) & 0x3f))) &&
+                 step(static_cast<unsigned char>(0x80 | ((cp >> 6) & 0x3f))) && step(static_cast<unsigned char>(0x80 | (cp & 0x3f)));
+          if (!ok)
+            return false;
+        }
+      }
+      return true;
+    }
+
+    // add the other case of the letters of a set of bytes
+    inline void fold_case(byte_set& set)
+    {
+      for (int c = 'a'; c <= 'z'; ++c)
+      {
+        if (set[c] || set[c - 'a' + 'A'])
+        {
+          set.set(c);
+          set.set(c - 'a' + 'A');
+        }
+      }
+    }
+
+    // parser of the content of a bracket expression: [abc], [a-z], [!a] or [^a]
+    // (the case is folded before the negation: [^a] excludes 'A' too when ignoring the case)
+    inline byte_set parse_bracket(const std::string_view str, std::size_t& pos, const bool glob, const bool ignore_case)
+    {
+      byte_set set;
+      bool negate = false;
+      if (pos < str.size() && (str[pos] == '^' || (glob && str[pos] == '!')))
+      {
+        negate = true;
+        ++pos;
+      }
+      bool first = true;
+      while (pos < str.size() && (first || str[pos] != ']'))
+      {
+        first = false;
+        unsigned char lo = static_cast<unsigned char>(str[pos++]);
+        if (!glob && lo == '\\' && pos < str.size())
+          lo = static_cast<unsigned char>(str[pos++]);
+        unsigned char hi = lo;
+        if (pos + 1 < str.size() && str[pos] == '-' && str[pos + 1] != ']')
+        {
+          hi = static_cast<unsigned char>(str[pos + 1]);
+          pos += 2;
+        }
+        for (int c = lo; c <= hi; ++c)
+          set.set(c);
+      }
+      if (pos >= str.size())
+        throw std::runtime_error(fmt::format("invalid pattern: \"{}\" (missing ']')", str));
+      ++pos;
+      if (ignore_case)
+        fold_case(set);
+      return negate ? ~set : set;
+    }
+
+    // parser of a simple regular expression (ECMAScript subset): literals, '.', bracket expressions,
+    // escapes (\d \w \s \.), groups, '|', '*', '+', '?', '^' at the start and '$' at the end of an alternative
+    class regex_parser final
+    {
+    public:
+      regex_parser(nfa& automaton, const std::string_view str, const bool ignore_case) :
+        m_nfa(automaton),
+        m_str(str),
+        m_pos(0),
+        m_ignore_case(ignore_case)
+      {
+      }
+
+      // regex_search semantics: the match of each top-level alternative can start and end anywhere unless anchored
+      nfa::fragment parse()
+      {
+        byte_set all;
+        all.set();
+        const int start = m_nfa.add();
+        for (;;)
+        {
+          const bool anchored_start = m_pos < m_str.size() && m_str[m_pos] == '^';
+          if (anchored_start)
+            ++m_pos;
+          nfa::fragment f = sequence();
+          const bool anchored_end = m_pos < m_str.size() && m_str[m_pos] == '$';
+          if (anchored_end)
+            ++m_pos;
+          if (!anchored_start)
+            f = m_nfa.concat(m_nfa.star(m_nfa.bytes(all)), f);
+          m_nfa.accept(f, anchored_end ? nfa::at_end : nfa::anywhere);
+          m_nfa.states()[start].epsilon.push_back(f.start);
+          if (m_pos >= m_str.size() || m_str[m_pos] != '|')
+            break;
+          ++m_pos;
+        }
+        if (m_pos != m_str.size())
+          throw std::runtime_error(fmt::format("invalid pattern: \"{}\" (unexpected '{}')", m_str, m_str[m_pos]));
+        return { start, start };
+      }
+
+    private:
+      nfa::fragment alternation()
+      {
+        nfa::fragment f = sequence();
+        while (m_pos < m_str.size() && m_str[m_pos] == '|')
+        {
+          ++m_pos;
+          f = m_nfa.alternate(f, sequence());
+        }
+        return f;
+      }
+
+      // stops before '|', ')' and before a '$' ending a top-level alternative
+      nfa::fragment sequence()
+      {
+        nfa::fragment f = m_nfa.empty();
+        while (m_pos < m_str.size() && m_str[m_pos] != '|' && m_str[m_pos] != ')' && !end_anchor())
+          f = m_nfa.concat(f, repetition());
+        return f;
+      }
+
+      bool end_anchor() const
+      {
+        return m_groups == 0 && m_str[m_pos] == '$' && (m_pos + 1 == m_str.size() || m_str[m_pos + 1] == '|');
+      }
+
+      nfa::fragment repetition()
+      {
+        nfa::fragment f = atom();
+        while (m_pos < m_str.size())
+        {
+          const char c = m_str[m_pos];
+          if (c == '*')
+            f = m_nfa.star(f);
+          else if (c == '+')
+            f = m_nfa.plus(f);
+          else if (c == '?')
+            f = m_nfa.optional(f);
+          else if (c == '{')
+            throw std::runtime_error(fmt::format("unsupported pattern: \"{}\" (counted repetition)", m_str));
+          else
+            break;
+          ++m_pos;
+        }
+        return f;
+      }
+
+      nfa::fragment atom()
+      {
+        const char c = m_str[m_pos++];
+        byte_set set;
+        switch (c)
+        {
+        case '(':
+        {
+          if (m_str.substr(m_pos, 2) == "?:")
+            m_pos += 2;
+          else if (m_pos < m_str.size() && m_str[m_pos] == '?')
+            throw std::runtime_error(fmt::format("unsupported pattern: \"{}\" (assertion)", m_str));
+          ++m_groups;
+          const nfa::fragment f = alternation();
+          --m_groups;
+          if (m_pos >= m_str.size() || m_str[m_pos] != ')')
+            throw std::runtime_error(fmt::format("invalid pattern: \"{}\" (missing ')')", m_str));
+          ++m_pos;
+          return f;
+        }
+        case '[':
+          set = parse_bracket(m_str, m_pos, false, m_ignore_case);
+          break;
+        case '.':
+          set.set();
+          set.reset('\n');
+          break;
+        case '\\':
+          set = escape();
+          break;
+        case '*':
+        case '+':
+        case '?':
+          throw std::runtime_error(fmt::format("unsupported pattern: \"{}\" (unexpected '{}')", m_str, c));
+        case '^':
+        case '$':
+          throw std::runtime_error(fmt::format("unsupported pattern: \"{}\" (unexpected '{}', '^' and '$' only at the start and the end of a top-level alternative)", m_str, c));
+        default:
+          set.set(static_cast<unsigned char>(c));
+          break;
+        }
+        if (m_ignore_case)
+          fold_case(set);
+        return m_nfa.bytes(set);
+      }
+
+      byte_set escape()
+      {
+        if (m_pos >= m_str.size())
+          throw std::runtime_error(fmt::format("invalid pattern: \"{}\" (trailing '\\')", m_str));
+        const char c = m_str[m_pos++];
+        byte_set set;
+        const auto& digit = [](const int b) { return std::isdigit(b) != 0; };
+        const auto& space = [](const int b) { return std::isspace(b) != 0; };
+        const auto& word = [](const int b) { return std::isalnum(b) != 0 || b == '_'; };
+        const auto& add_if = [&](const auto& test) {
+          for (int b = 0; b < 128; ++b)
+            if (test(b))
+              set.set(b);
+        };
+        switch (c)
+        {
+        case 'd': add_if(digit); break;
+        case 'D': add_if(digit); set.flip(); break;
+        case 's': add_if(space); break;
+        case 'S': add_if(space); set.flip(); break;
+        case 'w': add_if(word); break;
+        case 'W': add_if(word); set.flip(); break;
+        case 't': set.set('\t'); break;
+        case 'n': set.set('\n'); break;
+        default:
+          if (std::isalnum(static_cast<unsigned char>(c)))
+            throw std::runtime_error(fmt::format("unsupported pattern: \"{}\" (escape '\\{}')", m_str, c));
+          set.set(static_cast<unsigned char>(c));
+          break;
+        }
+        return set;
+      }
+
+    private:
+      nfa& m_nfa;
+      std::string_view m_str;
+      std::size_t m_pos;
+      std::size_t m_groups = 0;
+      bool m_ignore_case;
+    };
+
+    // parser of a glob: '*' (except separators), '**' (anything), '**/' (zero or more directories), '?',
+    // bracket expressions and {a,b} alternatives: the whole string has to match
+    class glob_parser final
+    {
+    public:
+      glob_parser(nfa& automaton, const std::string_view str, const bool ignore_case) :
+        m_nfa(automaton),
+        m_str(str),
+        m_pos(0),
+        m_ignore_case(ignore_case)
+      {
+      }
+
+      nfa::fragment parse()
+      {
+        nfa::fragment f = sequence(false);
+        if (m_pos != m_str.size())
+          throw std::runtime_error(fmt::format("invalid pattern: \"{}\" (unexpected '{}')", m_str, m_str[m_pos]));
+        m_nfa.accept(f, nfa::at_end);
+        return f;
+      }
+
+    private:
+      nfa::fragment sequence(const bool in_braces)
+      {
+        byte_set any;
+        any.set();
+        byte_set name = any;
+        name.reset('/');
+        name.reset('\\');
+
+        nfa::fragment f = m_nfa.empty();
+        while (m_pos < m_str.size())
+        {
+          const char c = m_str[m_pos];
+          if (in_braces && (c == ',' || c == '}'))
+            break;
+          ++m_pos;
+          if (c == '*')
+          {
+            const bool deep = m_pos < m_str.size() && m_str[m_pos] == '*';
+            while (m_pos < m_str.size() && m_str[m_pos] == '*')
+              ++m_pos;
+            if (deep && m_pos < m_str.size() && (m_str[m_pos] == '/' || m_str[m_pos] == '\\'))
+            {
+              // '**/': zero or more directories
+              byte_set separator;
+              separator.set(static_cast<unsigned char>(m_str[m_pos++]));
+              f = m_nfa.concat(f, m_nfa.optional(m_nfa.concat(m_nfa.star(m_nfa.bytes(any)), m_nfa.bytes(separator))));
+            }
+            else
+              f = m_nfa.concat(f, m_nfa.star(m_nfa.bytes(deep ? any : name)));
+          }
+          else if (c == '?')
+            f = m_nfa.concat(f, m_nfa.bytes(name));
+          else if (c == '{')
+            f = m_nfa.concat(f, braces());
+          else
+          {
+            byte_set set;
+            if (c == '[')
+              set = parse_bracket(m_str, m_pos, true, m_ignore_case);
+            else
+              set.set(static_cast<unsigned char>(c));
+            if (m_ignore_case)
+              fold_case(set);
+            f = m_nfa.concat(f, m_nfa.bytes(set));
+          }
+        }
+        return f;
+      }
+
+      nfa::fragment braces()
+      {
+        nfa::fragment f = sequence(true);
+        while (m_pos < m_str.size() && m_str[m_pos] == ',')
+        {
+          ++m_pos;
+          f = m_nfa.alternate(f, sequence(true));
+        }
+        if (m_pos >= m_str.size() || m_str[m_pos] != '}')
+          throw std::runtime_error(fmt::format("invalid pattern: \"{}\" (missing '}}')", m_str));
+        ++m_pos;
+        return f;
+      }
+
+    private:
+      nfa& m_nfa;
+      std::string_view m_str;
+      std::size_t m_pos;
+      bool m_ignore_case;
+    };
+  }
+
+  // filter compiled once into a deterministic automaton: a name is tested in one pass over its bytes,
+  // without allocation and whatever the number of alternatives (ex: a union of hundreds of extensions)
+  // the compiled pattern is immutable, it can be shared by the threads of a parallel walk
+  //   const auto& headers = files::pattern::glob("*.{h,hpp,hxx}");
+  //   const auto& temp = files::pattern::regex(R"(\.(tmp|bak)$|~$)", true);
+  class pattern final
+  {
+  public:
+    // pattern matching everything
+    pattern() :
+      pattern(std::vector<std::string>{ "" }, false, false)
+    {
+    }
+
+    // union of globs separated by ';', the whole name has to match:
+    // '*' (except separators), '**' (anything), '**/' (zero or more directories), '?', [abc], [a-z], [!a] and {a,b,c}
+    static pattern glob(const std::string& globs, const bool ignore_case = false)
+    {
+      std::vector<std::string> list;
+      std::size_t start = 0;
+      for (std::size_t end = globs.find(';'); end != std::string::npos; end = globs.find(';', start))
+      {
+        list.push_back(globs.substr(start, end - start));
+        start = end + 1;
+      }
+      list.push_back(globs.substr(start));
+      return pattern(list, true, ignore_case);
+    }
+
+    // union of globs
+    static pattern glob(const std::vector<std::string>& globs, const bool ignore_case = false)
+    {
+      return pattern(globs, true, ignore_case);
+    }
+
+    // simple regular expression searched like std::regex_search (ECMAScript subset):
+    // literals, '.', [...], \d \w \s, groups, '|', '*', '+', '?', '^' at the start and '$' at the end of an alternative
+    static pattern regex(const std::string& regex, const bool ignore_case = false)
+    {
+      return pattern(std::vector<std::string>{ regex }, false, ignore_case);
+    }
+
+    // true if the string matches
+    bool matches(const std::string_view str) const
+    {
+      return run(str.data(), str.data() + str.size());
+    }
+
+    // true if the full path matches
+    bool matches(const std::filesystem::path& path) const
+    {
+      const auto& native = path.native();
+      return run(native.data(), native.data() + native.size());
+    }
+
+    // true if the filename (with extension) of the path matches
+    bool matches_filename(const std::filesystem::path& path) const
+    {
+      const auto& native = path.native();
+      std::size_t start = native.size();
+      while (start > 0 && native[start - 1] != '/' && native[start - 1] != '\\')
+        --start;
+      return run(native.data() + start, native.data() + native.size());
+    }
+
+  private:
+    pattern(const std::vector<std::string>& patterns, const bool glob, const bool ignore_case) :
+      m_classes(0),
+      m_class(),
+      m_next(),
+      m_accept(),
+      m_start(0),
+      m_dead(0)
+    {
+      // union of the patterns
+      details::nfa automaton;
+      const int start = automaton.add();
+      for (const auto& str : patterns)
+      {
+        const details::nfa::fragment f = glob ? details::glob_parser(automaton, str, ignore_case).parse() :
+                                                details::regex_parser(automaton, str, ignore_case).parse();
+        automaton.states()[start].epsilon.push_back(f.start);
+      }
+      compile(automaton.states(), start);
+    }
+
+    // subset construction of the deterministic automaton, on the classes of equivalent bytes
+    void compile(const std::vector<details::nfa::state>& states, const int start)
+    {
+      std::array<std::size_t, 256> cls = {};
+      std::size_t count = 1;
+      for (const auto& s : states)
+      {
+        if (s.next < 0)
+          continue;
+        std::map<std::pair<std::size_t, bool>, std::size_t> split;
+        for (int b = 0; b < 256; ++b)
+        {
+          const auto& key = std::make_pair(cls[b], static_cast<bool>(s.bytes[b]));
+          const auto& it = split.emplace(key, split.size()).first;
+          cls[b] = it->second;
+        }
+        count = split.size();
+      }
+      m_classes = count;
+      std::vector<int> representative(m_classes, -1);
+      for (int b = 0; b < 256; ++b)
+      {
+        m_class[b] = static_cast<uint16_t>(cls[b]);
+        if (representative[cls[b]] < 0)
+          representative[cls[b]] = b;
+      }
+
+      const auto& closure = [&](std::vector<int> set) -> std::vector<int> {
+        std::vector<bool> seen(states.size(), false);
+        for (const int s : set)
+          seen[s] = true;
+        for (std::size_t i = 0; i < set.size(); ++i)
+          for (const int e : states[set[i]].epsilon)
+            if (!seen[e])
+            {
+              seen[e] = true;
+              set.push_back(e);
+            }
+        std::sort(set.begin(), set.end());
+        return set;
+      };
+
+      std::map<std::vector<int>, uint32_t> ids;
+      std::vector<std::vector<int>> sets;
+      const auto& get_id = [&](const std::vector<int>& set) -> uint32_t {
+        const auto& it = ids.find(set);
+        if (it != ids.end())
+          return it->second;
+        if (sets.size() >= max_pattern_states)
+          throw std::runtime_error(fmt::format("pattern too complex: more than {} states", max_pattern_states));
+        const uint32_t id = static_cast<uint32_t>(sets.size());
+        ids.emplace(set, id);
+        sets.push_back(set);
+        uint8_t accept = details::nfa::none;
+        for (const int s : set)
+          accept |= states[s].accept;
+        m_accept.push_back(accept);
+        m_next.resize(m_next.size() + m_classes, 0);
+        return id;
+      };
+
+      m_dead = get_id({});
+      m_start = get_id(closure({ start }));
+      for (std::size_t i = 0; i < sets.size(); ++i)
+      {
+        for (std::size_t c = 0; c < m_classes; ++c)
+        {
+          std::vector<int> target;
+          for (const int s : sets[i])
+            if (states[s].next >= 0 && states[s].bytes[representative[c]])
+              target.push_back(states[s].next);
+          const uint32_t id = get_id(closure(target));
+          m_next[i * m_classes + c] = id;
+        }
+      }
+    }
+
+    // bytes of the string (utf-8 for the wide strings of windows paths)
+    template <typename Char>
+    bool run(const Char* begin, const Char* end) const
+    {
+      uint32_t state = m_start;
+      const auto& step = [&](const unsigned char b) -> bool {
+        if (m_accept[state] & details::nfa::anywhere)
+          return false;
+        state = m_next[state * m_classes + m_class[b]];
+        return state != m_dead;
+      };
+
+      if (!details::utf8_bytes(begin, end, step))
+        return m_accept[state] & details::nfa::anywhere;
+      return m_accept[state] != details::nfa::none;
+    }
+
+  private:
+    std::size_t m_classes;
+    std::array<uint16_t, 256> m_class;
+    std::vector<uint32_t> m_next;
+    std::vector<uint8_t> m_accept;
+    uint32_t m_start;
+    uint32_t m_dead;
+  };
+}
@@ -0,0 +1,623 @@
+#pragma once
+#include <string>
+#include <string_view>
+#include <vector>
+#include <array>
+#include <atomic>
+#include <cstring>
+#include <cstdint>
+#include <fstream>
+#include <utility>
+#include <optional>
+#include <algorithm>
+#include <filesystem>
+#include <fmt/format.h>
+#if !defined(_WIN32)
+#include <sys/stat.h>
+#endif
+#include <winpp/files.hpp>
+
+namespace files
+{
+  // type of a snapshot entry (symbolic links are never followed)
+  enum class entry_type : uint8_t
+  {
+    file = 0,
+    directory = 1,
+    symlink = 2,
+    other = 3
+  };
+
+  // entry of a snapshot: relative path ('/' separated, empty for the root) and metadata
+  // mtime is in nanoseconds since the epoch, inode is 0 when the system doesn't provide it
+  struct snapshot_entry
+  {
+    std::string_view path;
+    std::size_t name_offset;
+    uint64_t size;
+    int64_t mtime;
+    uint64_t inode;
+    entry_type type;
+
+    // last component of the path
+    std::string_view name() const
+    {
+      return path.substr(name_offset);
+    }
+  };
+
+  // differences between two states of a tree: relative paths of the entries
+  struct snapshot_diff
+  {
+    std::vector<std::string> added;
+    std::vector<std::string> removed;
+    std::vector<std::string> modified;
+
+    bool empty() const
+    {
+      return added.empty() && removed.empty() && modified.empty();
+    }
+  };
+
+  namespace details
+  {
+    // layout of a snapshot file:
+    //   header | records (count * record_size bytes) | paths (names_size bytes)
+    // the records are sorted by (parent directory, name): the children of a directory are contiguous
+    struct snapshot_header
+    {
+      std::array<char, 8> magic;
+      uint32_t version;
+      uint32_t record_size;
+      uint64_t count;
+      uint64_t records_offset;
+      uint64_t names_offset;
+      uint64_t names_size;
+    };
+    struct snapshot_record
+    {
+      uint64_t size;
+      int64_t mtime;
+      uint64_t inode;
+      uint64_t path_offset;
+      uint32_t path_size;
+      uint16_t name_offset;
+      uint8_t type;
+      uint8_t reserved;
+    };
+    constexpr std::array<char, 8> snapshot_magic = { 'W', 'P', 'P', 'S', 'N', 'A', 'P', '1' };
+    constexpr uint32_t snapshot_version = 1;
+
+    // entry being collected before the snapshot is built
+    struct snapshot_item
+    {
+      std::string path;
+      std::size_t name_offset;
+      uint64_t size;
+      int64_t mtime;
+      uint64_t inode;
+      entry_type type;
+    };
+
+    // order of the records: parent directory (with its trailing '/') first, then name
+    inline int compare_entries(const std::string_view a, const std::size_t a_name,
+                               const std::string_view b, const std::size_t b_name)
+    {
+      const int cmp = a.substr(0, a_name).compare(b.substr(0, b_name));
+      return cmp ? cmp : a.substr(a_name).compare(b.substr(b_name));
+    }
+
+    // read the metadata of an entry without following links, returns false if it doesn't exist
+    inline bool stat_entry(const std::filesystem::path& p, snapshot_item& item)
+    {
+#if defined(_WIN32)
+      // one open for all the metadata with the file index (the link itself, not its target),
+      // the entries which can't be opened (pending deletion, no access) are read without index
+      WIN32_FILE_ATTRIBUTE_DATA data;
+      item.inode = 0;
+      const HANDLE file = CreateFileW(p.c_str(), FILE_READ_ATTRIBUTES, FILE_SHARE_READ | FILE_SHARE_WRITE | FILE_SHARE_DELETE, nullptr,
+                                      OPEN_EXISTING, FILE_FLAG_BACKUP_SEMANTICS | FILE_FLAG_OPEN_REPARSE_POINT, nullptr);
+      BY_HANDLE_FILE_INFORMATION info;
+      const bool opened = file != INVALID_HANDLE_VALUE && GetFileInformationByHandle(file, &info);
+      if (file != INVALID_HANDLE_VALUE)
+        CloseHandle(file);
+      if (opened)
+      {
+        data.dwFileAttributes = info.dwFileAttributes;
+        data.ftLastWriteTime = info.ftLastWriteTime;
+        data.nFileSizeHigh = info.nFileSizeHigh;
+        data.nFileSizeLow = info.nFileSizeLow;
+        item.inode = (static_cast<uint64_t>(info.nFileIndexHigh) << 32) | info.nFileIndexLow;
+      }
+      else if (!GetFileAttributesExW(p.c_str(), GetFileExInfoStandard, &data))
+        return false;
+      // FILETIME: 100 ns intervals since 1601-01-01
+      const int64_t ticks = (static_cast<int64_t>(data.ftLastWriteTime.dwHighDateTime) << 32) | data.ftLastWriteTime.dwLowDateTime;
+      item.mtime = (ticks - 116444736000000000ll) * 100;
+      item.size = (static_cast<uint64_t>(data.nFileSizeHigh) << 32) | data.nFileSizeLow;
+      if (data.dwFileAttributes & FILE_ATTRIBUTE_REPARSE_POINT)
+        item.type = entry_type::symlink;
+      else if (data.dwFileAttributes & FILE_ATTRIBUTE_DIRECTORY)
+        item.type = entry_type::directory;
+      else
+        item.type = entry_type::file;
+#else
+      struct stat st;
+      if (::lstat(p.c_str(), &st) != 0)
+        return false;
+#if defined(__linux__)
+      item.mtime = static_cast<int64_t>(st.st_mtim.tv_sec) * 1000000000ll + st.st_mtim.tv_nsec;
+#else
+      item.mtime = static_cast<int64_t>(st.st_mtime) * 1000000000ll;
+#endif
+      item.size = static_cast<uint64_t>(st.st_size);
+      item.inode = static_cast<uint64_t>(st.st_ino);
+      if (S_ISREG(st.st_mode))
+        item.type = entry_type::file;
+      else if (S_ISDIR(st.st_mode))
+        item.type = entry_type::directory;
+      else if (S_ISLNK(st.st_mode))
+        item.type = entry_type::symlink;
+      else
+        item.type = entry_type::other;
+#endif
+      // the size of a directory depends on the file system: not compared
+      if (item.type == entry_type::directory)
+        item.size = 0;
+      return true;
+    }
+
+    // relative path of a child entry
+    inline std::string child_path(const std::string& dir, const std::string_view name)
+    {
+      return dir.empty() ? std::string(name) : fmt::format("{}/{}", dir, name);
+    }
+  }
+
+  // snapshot of a tree: compact table of the entries with their size, mtime, inode and type
+  // saved as-is on disk and mapped in memory when reopened (nothing to parse)
+  //
+  // the snapshot keeps the mtime of each directory: a rescan only lists the directories
+  // whose mtime changed and only checks the metadata of the entries of the others
+  class snapshot final
+  {
+    snapshot(const snapshot&) = delete;
+    snapshot& operator=(const snapshot&) = delete;
+
+  public:
+    // empty snapshot
+    snapshot()
+    {
+      std::vector<details::snapshot_item> items;
+      build(items);
+    }
+
+    // map a snapshot file written with snapshot::save
+    explicit snapshot(const std::filesystem::path& path) :
+      m_view(path, { map_access::normal, false })
+    {
+      m_data = reinterpret_cast<const uint8_t*>(m_view.data());
+      m_size = m_view.size();
+      if (m_size < sizeof(details::snapshot_header) || !attach())
+        throw std::runtime_error(fmt::format("invalid snapshot: \"{}\"", path.filename().u8string()));
+    }
+
+    // build a snapshot from a list of entries under root (result of files::get_files with the directories)
+    snapshot(const std::filesystem::path& root, const std::vector<std::filesystem::path>& entries)
+    {
+      std::vector<details::snapshot_item> items;
+      items.reserve(entries.size() + 1);
+      details::snapshot_item item;
+      if (details::stat_entry(root, item))
+      {
+        item.name_offset = 0;
+        items.push_back(std::move(item));
+      }
+      for (const auto& entry : entries)
+      {
+        std::string rel = entry.lexically_relative(root).generic_u8string();
+        if (rel.empty() || rel == "." || !details::stat_entry(entry, item))
+          continue;
+        const std::size_t pos = rel.rfind('/');
+        item.name_offset = pos == std::string::npos ? 0 : pos + 1;
+        item.path = std::move(rel);
+        items.push_back(std::move(item));
+      }
+      build(items);
+    }
+
+    // build a snapshot from collected entries
+    explicit snapshot(std::vector<details::snapshot_item>& items)
+    {
+      build(items);
+    }
+
+    snapshot(snapshot&& other) noexcept
+    {
+      swap(other);
+    }
+
+    snapshot& operator=(snapshot&& other) noexcept
+    {
+      swap(other);
+      return *this;
+    }
+
+    // scan a whole tree (defined after files::diff)
+    static snapshot scan(const std::filesystem::path& root);
+
+    // number of entries (the root is the entry with an empty path)
+    std::size_t size() const
+    {
+      return static_cast<std::size_t>(m_header.count);
+    }
+
+    // entry by index, in (parent directory, name) order
+    snapshot_entry operator[](const std::size_t i) const
+    {
+      details::snapshot_record r;
+      std::memcpy(&r, m_records + i * sizeof(r), sizeof(r));
+      return { std::string_view(m_names + r.path_offset, r.path_size), r.name_offset,
+               r.size, r.mtime, r.inode, static_cast<entry_type>(r.type) };
+    }
+
+    // find an entry by its relative path
+    std::optional<snapshot_entry> find(const std::string_view path) const
+    {
+      const std::size_t pos = path.rfind('/');
+      const std::size_t name = pos == std::string_view::npos ? 0 : pos + 1;
+      std::size_t lo = 0, hi = size();
+      while (lo < hi)
+      {
+        const std::size_t mid = lo + (hi - lo) / 2;
+        const snapshot_entry e = (*this)[mid];
+        const int cmp = details::compare_entries(e.path, e.name_offset, path, name);
+        if (cmp == 0)
+          return e;
+        if (cmp < 0)
+          lo = mid + 1;
+        else
+          hi = mid;
+      }
+      return std::nullopt;
+    }
+
+    // range of indexes [first, last) of the entries of a directory (may contain the root entry for "")
+    std::pair<std::size_t, std::size_t> children(const std::string_view dir) const
+    {
+      const std::string parent = dir.empty() ? std::string() : fmt::format("{}/", dir);
+      const auto& lower = [&](const bool strict) {
+        std::size_t lo = 0, hi = size();
+        while (lo < hi)
+        {
+          const std::size_t mid = lo + (hi - lo) / 2;
+          const snapshot_entry e = (*this)[mid];
+          const int cmp = e.path.substr(0, e.name_offset).compare(parent);
+          if (cmp < 0 || (strict && cmp == 0))
+            lo = mid + 1;
+          else
+            hi = mid;
+        }
+        return lo;
+      };
+      return { lower(false), lower(true) };
+    }
+
+    // write the snapshot to a file
+    void save(const std::filesystem::path& path) const
+    {
+      std::ofstream file(path, std::ios::binary | std::ios::trunc);
+      if (!file.good())
+        throw std::runtime_error(fmt::format("can't create file: \"{}\"", path.filename().u8string()));
+      file.write(reinterpret_cast<const char*>(m_data), static_cast<std::streamsize>(m_size));
+      if (!file.good())
+        throw std::runtime_error(fmt::format("can't write file: \"{}\"", path.filename().u8string()));
+    }
+
+  private:
+    // sort the entries and lay them out like a snapshot file
+    void build(std::vector<details::snapshot_item>& items)
+    {
+      std::sort(items.begin(), items.end(), [](const auto& a, const auto& b) {
+        return details::compare_entries(a.path, a.name_offset, b.path, b.name_offset) < 0;
+      });
+      items.erase(std::unique(items.begin(), items.end(), [](const auto& a, const auto& b) { return a.path == b.path; }), items.end());
+
+      details::snapshot_header header = {};
+      header.magic = details::snapshot_magic;
+      header.version = details::snapshot_version;
+      header.record_size = sizeof(details::snapshot_record);
+      header.count = items.size();
+      header.records_offset = sizeof(header);
+      header.names_offset = header.records_offset + header.count * sizeof(details::snapshot_record);
+      for (const auto& item : items)
+        header.names_size += item.path.size();
+
+      m_buffer.assign(static_cast<std::size_t>(header.names_offset + header.names_size), 0);
+      std::memcpy(m_buffer.data(), &header, sizeof(header));
+      uint64_t offset = 0;
+      for (std::size_t i = 0; i < items.size(); ++i)
+      {
+        const auto& item = items[i];
+        if (item.path.size() > UINT16_MAX)
+          throw std::runtime_error(fmt::format("path too long: \"{}\"", item.path));
+        details::snapshot_record r = {};
+        r.size = item.size;
+        r.mtime = item.mtime;
+        r.inode = item.inode;
+        r.path_offset = offset;
+        r.path_size = static_cast<uint32_t>(item.path.size());
+        r.name_offset = static_cast<uint16_t>(item.name_offset);
+        r.type = static_cast<uint8_t>(item.type);
+        std::memcpy(m_buffer.data() + header.records_offset + i * sizeof(r), &r, sizeof(r));
+        std::memcpy(m_buffer.data() + header.names_offset + offset, item.path.data(), item.path.size());
+        offset += item.path.size();
+      }
+      m_data = m_buffer.data();
+      m_size = m_buffer.size();
+      attach();
+    }
+
+    // check the header and the records of the data (the offsets come from the file: no sum nor product can overflow)
+    bool attach()
+    {
+      std::memcpy(&m_header, m_data, sizeof(m_header));
+      const bool valid = m_header.magic == details::snapshot_magic &&
+                         m_header.version == details::snapshot_version &&
+                         m_header.record_size == sizeof(details::snapshot_record) &&
+                         m_header.records_offset >= sizeof(m_header) &&
+                         m_header.records_offset <= m_header.names_offset &&
+                         m_header.count <= (m_header.names_offset - m_header.records_offset) / sizeof(details::snapshot_record) &&
+                         m_header.names_offset <= m_size &&
+                         m_header.names_size <= m_size - m_header.names_offset;
+      if (!valid)
+        return false;
+      m_records = m_data + m_header.records_offset;
+      m_names = reinterpret_cast<const char*>(m_data + m_header.names_offset);
+      for (std::size_t i = 0; i < size(); ++i)
+      {
+        details::snapshot_record r;
+        std::memcpy(&r, m_records + i * sizeof(r), sizeof(r));
+        if (r.path_size > m_header.names_size || r.path_offset > m_header.names_size - r.path_size || r.name_offset > r.path_size)
+          return false;
+      }
+      return true;
+    }
+
+    void swap(snapshot& other) noexcept
+    {
+      std::swap(m_header, other.m_header);
+      std::swap(m_buffer, other.m_buffer);
+      std::swap(m_view, other.m_view);
+      std::swap(m_data, other.m_data);
+      std::swap(m_size, other.m_size);
+      std::swap(m_records, other.m_records);
+      std::swap(m_names, other.m_names);
+    }
+
+  private:
+    details::snapshot_header m_header = {};
+    std::vector<uint8_t> m_buffer;
+    file_view m_view;
+    const uint8_t* m_data = nullptr;
+    std::size_t m_size = 0;
+    const uint8_t* m_records = nullptr;
+    const char* m_names = nullptr;
+  };
+
+  namespace details
+  {
+    // same entry with a different content: size, mtime or identity (file replaced)
+    inline bool is_modified(const snapshot_entry& before, const snapshot_item& after)
+    {
+      return before.size != after.size ||
+             before.mtime != after.mtime ||
+             (before.inode && after.inode && before.inode != after.inode);
+    }
+
+    // rescan of a tree against a snapshot
+    class snapshot_scanner final
+    {
+    public:
+      snapshot_scanner(const snapshot& before, snapshot_diff& diff, std::vector<snapshot_item>& items) :
+        m_before(before),
+        m_diff(diff),
+        m_items(items),
+        m_stop(false)
+      {
+      }
+
+      void run(const std::filesystem::path& root)
+      {
+        snapshot_item item;
+        if (!stat_entry(root, item) || item.type != entry_type::directory)
+          throw std::runtime_error(fmt::format("can't open directory: \"{}\"", root.u8string()));
+        item.name_offset = 0;
+        // the root sorts first among the entries of ""
+        const auto [first, last] = m_before.children("");
+        visit(std::move(item), root, first < last && m_before[first].path.empty() ? first : npos);
+      }
+
+    private:
+      static constexpr std::size_t npos = static_cast<std::size_t>(-1);
+
+      // report an entry of the snapshot and all its children as removed
+      void remove(const std::size_t i)
+      {
+        const snapshot_entry e = m_before[i];
+        m_diff.removed.emplace_back(e.path);
+        if (e.type != entry_type::directory)
+          return;
+        const auto [first, last] = m_before.children(e.path);
+        for (std::size_t j = first; j < last; ++j)
+        {
+          if (!m_before[j].path.empty())
+            remove(j);
+        }
+      }
+
+      // compare an existing entry with the snapshot (old: its index, npos if it is new)
+      void visit(snapshot_item&& item, const std::filesystem::path& path, std::size_t old)
+      {
+        bool unchanged_dir = false;
+        if (old != npos)
+        {
+          const snapshot_entry e = m_before[old];
+          if (e.type != item.type)
+          {
+            remove(old);
+            m_diff.added.push_back(item.path);
+            old = npos;
+          }
+          else if (item.type == entry_type::directory)
+            unchanged_dir = e.mtime == item.mtime && e.inode == item.inode;
+          else if (is_modified(e, item))
+            m_diff.modified.push_back(item.path);
+        }
+        else if (!item.path.empty())
+          m_diff.added.push_back(item.path);
+
+        const bool is_dir = item.type == entry_type::directory;
+        const std::string rel = item.path;
+        m_items.push_back(std::move(item));
+        if (is_dir)
+          visit_dir(rel, path, old, unchanged_dir);
+      }
+
+      // compare the entries of a directory with the snapshot
+      void visit_dir(const std::string& rel, const std::filesystem::path& path, const std::size_t old, const bool unchanged)
+      {
+        std::size_t first = 0, last = 0;
+        if (old != npos)
+          std::tie(first, last) = m_before.children(rel);
+
+        // same mtime: no entry was added or removed, the listing of the snapshot is still valid
+        snapshot_item item;
+        if (unchanged)
+        {
+          for (std::size_t i = first; i < last; ++i)
+          {
+            const snapshot_entry e = m_before[i];
+            if (e.path.empty())
+              continue;
+            const std::filesystem::path p = path / std::filesystem::u8path(e.name());
+            if (!stat_entry(p, item))
+            {
+              remove(i);
+              continue;
+            }
+            item.path = std::string(e.path);
+            item.name_offset = e.name_offset;
+            visit(std::move(item), p, i);
+          }
+          return;
+        }
+
+        // otherwise list the directory and merge its entries with the ones of the snapshot
+        std::vector<std::string> names;
+        const auto& on_entry = [&](const std::filesystem::path& p, const bool, const int) -> bool {
+          names.push_back(p.filename().u8string());
+          return false;
+        };
+        list_dir(open_dir(path), path, 0, on_entry, nullptr, m_stop);
+        std::sort(names.begin(), names.end());
+
+        std::size_t i = first;
+        for (const auto& name : names)
+        {
+          while (i < last && (m_before[i].path.empty() || m_before[i].name() < name))
+          {
+            if (!m_before[i].path.empty())
+              remove(i);
+            ++i;
+          }
+          const bool known = i < last && m_before[i].name() == name;
+          const std::filesystem::path p = path / std::filesystem::u8path(name);
+          if (stat_entry(p, item))
+          {
+            item.path = child_path(rel, name);
+            item.name_offset = rel.empty() ? 0 : rel.size() + 1;
+            visit(std::move(item), p, known ? i : npos);
+          }
+          else if (known)
+            remove(i);
+          if (known)
+            ++i;
+        }
+        for (; i < last; ++i)
+        {
+          if (!m_before[i].path.empty())
+            remove(i);
+        }
+      }
+
+    private:
+      const snapshot& m_before;
+      snapshot_diff& m_diff;
+      std::vector<snapshot_item>& m_items;
+      std::atomic<bool> m_stop;
+    };
+  }
+
+  // compare two snapshots of the same tree
+  inline snapshot_diff diff(const snapshot& before, const snapshot& after)
+  {
+    // both are sorted the same way: a single merge
+    snapshot_diff result;
+    std::size_t i = 0, j = 0;
+    while (i < before.size() || j < after.size())
+    {
+      int cmp = 0;
+      if (i == before.size())
+        cmp = 1;
+      else if (j == after.size())
+        cmp = -1;
+      else
+        cmp = details::compare_entries(before[i].path, before[i].name_offset, after[j].path, after[j].name_offset);
+
+      if (cmp < 0)
+        result.removed.emplace_back(before[i++].path);
+      else if (cmp > 0)
+        result.added.emplace_back(after[j++].path);
+      else
+      {
+        const snapshot_entry a = before[i++];
+        const snapshot_entry b = after[j++];
+        if (a.type != b.type)
+        {
+          result.removed.emplace_back(a.path);
+          result.added.emplace_back(b.path);
+        }
+        else if (a.type != entry_type::directory &&
+                 (a.size != b.size || a.mtime != b.mtime || (a.inode && b.inode && a.inode != b.inode)))
+          result.modified.emplace_back(b.path);
+      }
+    }
+    std::sort(result.added.begin(), result.added.end());
+    std::sort(result.removed.begin(), result.removed.end());
+    std::sort(result.modified.begin(), result.modified.end());
+    return result;
+  }
+
+  // compare a snapshot with the current state of its tree, after receives the new snapshot if set
+  // the directories with the same mtime are not listed again: only the metadata of their entries is read
+  inline snapshot_diff diff(const snapshot& before, const std::filesystem::path& root, snapshot* after = nullptr)
+  {
+    snapshot_diff result;
+    std::vector<details::snapshot_item> items;
+    details::snapshot_scanner(before, result, items).run(root);
+    if (after)
+      *after = snapshot(items);
+    std::sort(result.added.begin(), result.added.end());
+    std::sort(result.removed.begin(), result.removed.end());
+    std::sort(result.modified.begin(), result.modified.end());
+    return result;
+  }
+
+  inline snapshot snapshot::scan(const std::filesystem::path& root)
+  {
+    snapshot result;
+    diff(snapshot(), root, &result);
+    return result;
+  }
+}
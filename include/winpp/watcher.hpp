@@ -0,0 +1,581 @@
+#pragma once
+#include <set>
+#include <regex>
+#include <string>
+#include <vector>
+#include <memory>
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <thread>
+#include <mutex>
+#include <exception>
+#include <stdexcept>
+#include <algorithm>
+#include <filesystem>
+#include <functional>
+#include <condition_variable>
+#include <fmt/format.h>
+#if defined(_WIN32)
+#include <windows.h>
+#elif defined(__linux__)
+#include <cerrno>
+#include <unordered_map>
+#include <poll.h>
+#include <unistd.h>
+#include <sys/inotify.h>
+#include <sys/eventfd.h>
+#endif
+#include <winpp/files.hpp>
+
+namespace files
+{
+  // quiet time after a change before the list is published: a burst of changes gives a single update
+  constexpr std::chrono::milliseconds default_watch_delay(50);
+
+  namespace details
+  {
+    // the system can't watch more directories (inotify limit): never ignored, unlike a vanished directory
+    class watch_limit_error final : public std::runtime_error
+    {
+    public:
+      using std::runtime_error::runtime_error;
+    };
+  }
+
+  // keep the result of files::get_files up to date: the tree is walked once, then the list is
+  // updated from the change notifications of the system (ReadDirectoryChangesW, inotify)
+  //
+  // the changes are applied as they arrive and published once the tree is quiet for the delay
+  // (or every 10 delays during a continuous burst), the tree is walked again if the system
+  // dropped notifications
+  class watcher final
+  {
+    watcher(const watcher&) = delete;
+    watcher& operator=(const watcher&) = delete;
+
+  public:
+    using filter = std::function<bool(const std::filesystem::path&)>;
+
+    // watch a directory and its sub-directories with filtering (using a std::function)
+    watcher(const std::filesystem::path& path,
+            const bool include_dirs,
+            const filter& dir_filter,
+            const filter& file_filter,
+            const std::chrono::milliseconds delay = default_watch_delay) :
+      m_root(path),
+      m_include_dirs(include_dirs),
+      m_dir_filter(dir_filter),
+      m_file_filter(file_filter),
+      m_delay(std::max(delay, std::chrono::milliseconds(1))),
+      m_entries(),
+      m_files(std::make_shared<const std::vector<std::filesystem::path>>()),
+      m_version(0),
+      m_stop(false),
+      m_error(),
+      m_mutex(),
+      m_cond(),
+      m_thread()
+    {
+      if (!std::filesystem::is_directory(path))
+        throw std::runtime_error(fmt::format("invalid directory: \"{}\"", path.u8string()));
+
+      open();
+      try
+      {
+        scan();
+      }
+      catch (...)
+      {
+        close();
+        throw;
+      }
+      publish();
+      m_thread = std::thread([this]() {
+        try
+        {
+          run();
+        }
+        catch (...)
+        {
+          std::lock_guard<std::mutex> lck(m_mutex);
+          m_error = std::current_exception();
+          m_cond.notify_all();
+        }
+      });
+    }
+
+    // watch a directory and its sub-directories with filtering (using a std::regex, fullpath for dir, filename with extension for file)
+    explicit watcher(const std::filesystem::path& path,
+                     const bool include_dirs = false,
+                     const std::regex& dir_regex = all_dirs,
+                     const std::regex& file_regex = all_files,
+                     const std::vector<std::filesystem::path>& skip_dirs = {},
+                     const std::vector<std::filesystem::path>& skip_files = {},
+                     const std::chrono::milliseconds delay = default_watch_delay) :
+      watcher(path, include_dirs, details::make_dir_filter(dir_regex, skip_dirs), details::make_file_filter(file_regex, skip_files), delay)
+    {
+    }
+
+    // destructor
+    ~watcher()
+    {
+      m_stop = true;
+      wake();
+      m_thread.join();
+      close();
+    }
+
+    // current list of the entries, sorted: shared and never modified, the next updates build new lists
+    std::shared_ptr<const std::vector<std::filesystem::path>> files() const
+    {
+      std::lock_guard<std::mutex> lck(m_mutex);
+      if (m_error)
+        std::rethrow_exception(m_error);
+      return m_files;
+    }
+
+    // number of updates of the list
+    uint64_t version() const
+    {
+      std::lock_guard<std::mutex> lck(m_mutex);
+      return m_version;
+    }
+
+    // wait until the list is updated after version, returns false on timeout
+    bool wait(const uint64_t version, const std::chrono::milliseconds timeout) const
+    {
+      std::unique_lock<std::mutex> lck(m_mutex);
+      const bool updated = m_cond.wait_for(lck, timeout, [&]() { return m_error || m_version > version; });
+      if (m_error)
+        std::rethrow_exception(m_error);
+      return updated;
+    }
+
+  private:
+    // same filters as files::get_files
+    void add_entry(const std::filesystem::path& p, const bool is_dir)
+    {
+      if (is_dir ? m_include_dirs && m_dir_filter(p) : m_dir_filter(p) && m_file_filter(p))
+        m_entries.insert(p);
+    }
+
+    // walk a directory: its sub-directories are watched before being listed
+    void add_dir(const std::filesystem::path& dir)
+    {
+      watch(dir);
+      details::walk(dir, [&](const std::filesystem::path& p, const bool is_dir, const int) -> bool {
+        add_entry(p, is_dir);
+        if (is_dir)
+          watch(p);
+        return is_dir;
+      }, m_stop);
+    }
+
+    // new entry: a directory comes with its content (created or moved in)
+    bool add_tree(const std::filesystem::path& p)
+    {
+      std::error_code ec;
+      const std::filesystem::file_status st = std::filesystem::symlink_status(p, ec);
+      if (ec || !std::filesystem::exists(st))
+        return false;
+      const bool is_link = std::filesystem::is_symlink(st);
+      const bool is_dir = is_link ? std::filesystem::is_directory(p, ec) : std::filesystem::is_directory(st);
+      add_entry(p, is_dir);
+      if (is_dir && !is_link)
+      {
+        // removed while being listed: its removal is notified next
+        try
+        {
+          add_dir(p);
+        }
+        catch (const details::watch_limit_error&)
+        {
+          throw;
+        }
+        catch (const std::exception&)
+        {
+        }
+      }
+      return true;
+    }
+
+    // removed entry: with its content if it was a directory
+    bool remove_tree(const std::filesystem::path& p)
+    {
+      const auto& inside = [&](const std::filesystem::path& e) {
+        return std::mismatch(p.begin(), p.end(), e.begin(), e.end()).first == p.end();
+      };
+      // the entries of a directory are sorted right after it
+      auto it = m_entries.lower_bound(p);
+      const auto first = it;
+      while (it != m_entries.end() && inside(*it))
+        ++it;
+      m_entries.erase(first, it);
+      unwatch(p);
+      return true;
+    }
+
+    // walk the whole tree
+    void scan()
+    {
+      m_entries.clear();
+      add_dir(m_root);
+    }
+
+    // publish the current list and wake up the waiting threads
+    void publish()
+    {
+      auto files = std::make_shared<const std::vector<std::filesystem::path>>(m_entries.begin(), m_entries.end());
+      std::lock_guard<std::mutex> lck(m_mutex);
+      m_files = std::move(files);
+      ++m_version;
+      m_cond.notify_all();
+    }
+
+    // wait for changes, returns false when stopped
+    //   timeout: time left before publishing the pending changes (none if there isn't any)
+    //   changed: set when a change was applied to the list
+    bool next(const std::chrono::milliseconds* timeout, bool& changed);
+
+    // watching thread: apply the changes and publish them by bursts
+    void run()
+    {
+      using clock = std::chrono::steady_clock;
+      const std::chrono::milliseconds max_wait = m_delay * 10;
+      bool pending = false;
+      clock::time_point first_change, last_change;
+      while (true)
+      {
+        std::chrono::milliseconds timeout(0);
+        if (pending)
+        {
+          const clock::time_point now = clock::now();
+          const auto quiet = last_change + m_delay - now;
+          const auto burst = first_change + max_wait - now;
+          timeout = std::max(std::chrono::milliseconds(0), std::chrono::duration_cast<std::chrono::milliseconds>(std::min(quiet, burst)));
+        }
+        if (pending && timeout.count() == 0)
+        {
+          publish();
+          pending = false;
+          continue;
+        }
+
+        bool changed = false;
+        if (!next(pending ? &timeout : nullptr, changed))
+          return;
+        if (changed)
+        {
+          last_change = clock::now();
+          if (!pending)
+            first_change = last_change;
+          pending = true;
+        }
+      }
+    }
+
+    // system specific
+    void open();
+    void close();
+    void wake();
+    void watch(const std::filesystem::path& dir);
+    void unwatch(const std::filesystem::path& dir);
+#if defined(_WIN32)
+    void read_changes();
+#endif
+
+  private:
+    std::filesystem::path m_root;
+    bool m_include_dirs;
+    filter m_dir_filter;
+    filter m_file_filter;
+    std::chrono::milliseconds m_delay;
+    std::set<std::filesystem::path> m_entries;
+    std::shared_ptr<const std::vector<std::filesystem::path>> m_files;
+    uint64_t m_version;
+    std::atomic<bool> m_stop;
+    std::exception_ptr m_error;
+    mutable std::mutex m_mutex;
+    mutable std::condition_variable m_cond;
+    std::thread m_thread;
+#if defined(_WIN32)
+    HANDLE m_dir = INVALID_HANDLE_VALUE;
+    HANDLE m_wake = nullptr;
+    OVERLAPPED m_overlapped = {};
+    std::vector<DWORD> m_buffer;
+#elif defined(__linux__)
+    int m_fd = -1;
+    int m_wake = -1;
+    std::unordered_map<int, std::filesystem::path> m_watches;
+#endif
+  };
+
+#if defined(_WIN32)
+  // a single recursive watch on the root: the sub-directories don't need their own
+  inline void watcher::open()
+  {
+    m_dir = CreateFileW(m_root.c_str(), FILE_LIST_DIRECTORY, FILE_SHARE_READ | FILE_SHARE_WRITE | FILE_SHARE_DELETE,
+                        nullptr, OPEN_EXISTING, FILE_FLAG_BACKUP_SEMANTICS | FILE_FLAG_OVERLAPPED, nullptr);
+    if (m_dir == INVALID_HANDLE_VALUE)
+      throw std::runtime_error(fmt::format("can't watch directory: \"{}\"", m_root.u8string()));
+    m_wake = CreateEventW(nullptr, TRUE, FALSE, nullptr);
+    m_overlapped.hEvent = CreateEventW(nullptr, TRUE, FALSE, nullptr);
+    // 64 KiB: maximum size for the network shares
+    m_buffer.resize(16 * 1024);
+    read_changes();
+  }
+
+  inline void watcher::close()
+  {
+    if (m_dir != INVALID_HANDLE_VALUE)
+    {
+      DWORD bytes = 0;
+      if (CancelIoEx(m_dir, &m_overlapped) || GetLastError() != ERROR_NOT_FOUND)
+        GetOverlappedResult(m_dir, &m_overlapped, &bytes, TRUE);
+      CloseHandle(m_dir);
+    }
+    if (m_overlapped.hEvent)
+      CloseHandle(m_overlapped.hEvent);
+    if (m_wake)
+      CloseHandle(m_wake);
+    m_dir = INVALID_HANDLE_VALUE;
+    m_overlapped.hEvent = nullptr;
+    m_wake = nullptr;
+  }
+
+  inline void watcher::wake()
+  {
+    SetEvent(m_wake);
+  }
+
+  inline void watcher::watch(const std::filesystem::path&)
+  {
+  }
+
+  inline void watcher::unwatch(const std::filesystem::path&)
+  {
+  }
+
+  // (re)start the recursive read of the changes: the system queues the changes from this point
+  inline void watcher::read_changes()
+  {
+    ResetEvent(m_overlapped.hEvent);
+    if (!ReadDirectoryChangesW(m_dir, m_buffer.data(), static_cast<DWORD>(m_buffer.size() * sizeof(DWORD)), TRUE,
+                               FILE_NOTIFY_CHANGE_FILE_NAME | FILE_NOTIFY_CHANGE_DIR_NAME, nullptr, &m_overlapped, nullptr))
+      throw std::runtime_error(fmt::format("can't watch directory: \"{}\"", m_root.u8string()));
+  }
+
+  inline bool watcher::next(const std::chrono::milliseconds* timeout, bool& changed)
+  {
+    const HANDLE handles[2] = { m_wake, m_overlapped.hEvent };
+    const DWORD wait = WaitForMultipleObjects(2, handles, FALSE, timeout ? static_cast<DWORD>(timeout->count()) : INFINITE);
+    if (m_stop || wait == WAIT_OBJECT_0)
+      return false;
+    if (wait == WAIT_TIMEOUT)
+      return true;
+
+    DWORD bytes = 0;
+    const bool done = GetOverlappedResult(m_dir, &m_overlapped, &bytes, FALSE) != 0;
+    if (!done && GetLastError() != ERROR_NOTIFY_ENUM_DIR)
+      throw std::runtime_error(fmt::format("can't watch directory: \"{}\"", m_root.u8string()));
+
+    // copy the notifications and start the next read right away: no change is lost while they are applied
+    std::vector<DWORD> buffer(m_buffer.begin(), m_buffer.begin() + (bytes + sizeof(DWORD) - 1) / sizeof(DWORD));
+    read_changes();
+    changed = true;
+
+    // too many changes: the system only reports that the notifications were dropped
+    if (!done || bytes == 0)
+    {
+      scan();
+      return true;
+    }
+
+    const uint8_t* data = reinterpret_cast<const uint8_t*>(buffer.data());
+    while (true)
+    {
+      const auto* info = reinterpret_cast<const FILE_NOTIFY_INFORMATION*>(data);
+      const std::filesystem::path p = m_root / std::wstring(info->FileName, info->FileNameLength / sizeof(WCHAR));
+      switch (info->Action)
+      {
+      case FILE_ACTION_ADDED:
+      case FILE_ACTION_RENAMED_NEW_NAME:
+        add_tree(p);
+        break;
+      case FILE_ACTION_REMOVED:
+      case FILE_ACTION_RENAMED_OLD_NAME:
+        remove_tree(p);
+        break;
+      default:
+        break;
+      }
+      if (!info->NextEntryOffset)
+        break;
+      data += info->NextEntryOffset;
+    }
+    return true;
+  }
+#elif defined(__linux__)
+  // one watch per directory: inotify isn't recursive
+  inline void watcher::open()
+  {
+    m_fd = inotify_init1(IN_NONBLOCK | IN_CLOEXEC);
+    m_wake = eventfd(0, EFD_NONBLOCK | EFD_CLOEXEC);
+    if (m_fd < 0 || m_wake < 0)
+    {
+      close();
+      throw std::runtime_error(fmt::format("can't watch directory: \"{}\"", m_root.u8string()));
+    }
+  }
+
+  inline void watcher::close()
+  {
+    if (m_fd >= 0)
+      ::close(m_fd);
+    if (m_wake >= 0)
+      ::close(m_wake);
+    m_fd = -1;
+    m_wake = -1;
+    m_watches.clear();
+  }
+
+  inline void watcher::wake()
+  {
+    const uint64_t one = 1;
+    [[maybe_unused]] const ssize_t n = ::write(m_wake, &one, sizeof(one));
+  }
+
+  inline void watcher::watch(const std::filesystem::path& dir)
+  {
+    const uint32_t mask = IN_CREATE | IN_DELETE | IN_MOVED_FROM | IN_MOVED_TO | IN_DELETE_SELF | IN_MOVE_SELF |
+                          IN_ONLYDIR | IN_DONT_FOLLOW | IN_EXCL_UNLINK;
+    const int wd = inotify_add_watch(m_fd, dir.c_str(), mask);
+    if (wd >= 0)
+      m_watches[wd] = dir;
+    else if (errno == ENOSPC)
+      throw details::watch_limit_error(fmt::format("too many directories to watch: \"{}\"", m_root.u8string()));
+  }
+
+  // a directory moved out of the tree would still be watched: remove the watches of its sub-tree
+  inline void watcher::unwatch(const std::filesystem::path& dir)
+  {
+    const auto& inside = [&](const std::filesystem::path& e) {
+      return std::mismatch(dir.begin(), dir.end(), e.begin(), e.end()).first == dir.end();
+    };
+    for (auto it = m_watches.begin(); it != m_watches.end();)
+    {
+      if (inside(it->second))
+      {
+        inotify_rm_watch(m_fd, it->first);
+        it = m_watches.erase(it);
+      }
+      else
+        ++it;
+    }
+  }
+
+  inline bool watcher::next(const std::chrono::milliseconds* timeout, bool& changed)
+  {
+    pollfd fds[2] = { { m_fd, POLLIN, 0 }, { m_wake, POLLIN, 0 } };
+    const int n = ::poll(fds, 2, timeout ? static_cast<int>(timeout->count()) : -1);
+    if (m_stop || (n > 0 && fds[1].revents))
+      return false;
+    if (n < 0 && errno != EINTR)
+      throw std::runtime_error(fmt::format("can't watch directory: \"{}\"", m_root.u8string()));
+    if (n <= 0)
+      return true;
+
+    alignas(inotify_event) char buffer[64 * 1024];
+    const ssize_t len = ::read(m_fd, buffer, sizeof(buffer));
+    if (len < 0)
+    {
+      if (errno == EAGAIN || errno == EINTR)
+        return true;
+      throw std::runtime_error(fmt::format("can't watch directory: \"{}\"", m_root.u8string()));
+    }
+
+    for (ssize_t pos = 0; pos < len;)
+    {
+      const auto* event = reinterpret_cast<const inotify_event*>(buffer + pos);
+      pos += sizeof(inotify_event) + event->len;
+
+      // too many changes: the queue overflowed, the notifications were dropped
+      if (event->mask & IN_Q_OVERFLOW)
+      {
+        for (const auto& [wd, dir] : m_watches)
+          inotify_rm_watch(m_fd, wd);
+        m_watches.clear();
+        scan();
+        changed = true;
+        continue;
+      }
+
+      const auto it = m_watches.find(event->wd);
+      if (it == m_watches.end())
+        continue;
+      if (event->mask & IN_IGNORED)
+      {
+        m_watches.erase(it);
+        continue;
+      }
+      // the root removed or moved away: the watches would follow the moved directory
+      if (event->mask & (IN_DELETE_SELF | IN_MOVE_SELF))
+      {
+        if (it->second == m_root)
+        {
+          m_entries.clear();
+          unwatch(m_root);
+          changed = true;
+        }
+        continue;
+      }
+
+      const std::filesystem::path p = it->second / event->name;
+      if (event->mask & (IN_CREATE | IN_MOVED_TO))
+        changed |= add_tree(p);
+      else if (event->mask & (IN_DELETE | IN_MOVED_FROM))
+        changed |= remove_tree(p);
+    }
+    return true;
+  }
+#else
+  // no change notification: the tree is walked again periodically
+  inline void watcher::open()
+  {
+  }
+
+  inline void watcher::close()
+  {
+  }
+
+  inline void watcher::wake()
+  {
+    std::lock_guard<std::mutex> lck(m_mutex);
+    m_cond.notify_all();
+  }
+
+  inline void watcher::watch(const std::filesystem::path&)
+  {
+  }
+
+  inline void watcher::unwatch(const std::filesystem::path&)
+  {
+  }
+
+  inline bool watcher::next(const std::chrono::milliseconds* timeout, bool& changed)
+  {
+    {
+      std::unique_lock<std::mutex> lck(m_mutex);
+      if (m_cond.wait_for(lck, timeout ? *timeout : m_delay * 20, [this]() -> bool { return m_stop; }))
+        return false;
+    }
+    if (timeout)
+      return true;
+    const std::set<std::filesystem::path> previous = std::move(m_entries);
+    scan();
+    changed = m_entries != previous;
+    return true;
+  }
+#endif
+}
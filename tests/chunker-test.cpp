@@ -0,0 +1,97 @@
+#include <set>
+#include <array>
+#include <string>
+#include <vector>
+#include <winpp/chunker.hpp>
+#include "test.hpp"
+
+// chunker: chunk sizes at the boundaries (minimum, maximum, min == max), independence
+// from the way the stream is fed, chunk hashes and resynchronization after an insertion
+namespace
+{
+  constexpr hashpp::ALGORITHMS algorithm = hashpp::ALGORITHMS::SHA2_256;
+
+  std::vector<files::chunk> split(const std::string& data, const std::size_t step, const std::array<std::size_t, 3>& sizes)
+  {
+    std::vector<files::chunk> chunks;
+    const auto& on_chunk = [&](const files::chunk& c) { chunks.push_back(c); };
+    files::chunker cdc(algorithm, sizes[0], sizes[1], sizes[2]);
+    const uint8_t* bytes = reinterpret_cast<const uint8_t*>(data.data());
+    for (std::size_t pos = 0; pos < data.size(); pos += step)
+      cdc.update(bytes + pos, std::min(step, data.size() - pos), on_chunk);
+    cdc.finalize(on_chunk);
+    return chunks;
+  }
+
+  bool same(const std::vector<files::chunk>& a, const std::vector<files::chunk>& b)
+  {
+    if (a.size() != b.size())
+      return false;
+    for (std::size_t i = 0; i < a.size(); ++i)
+    {
+      if (a[i].offset != b[i].offset || a[i].length != b[i].length || a[i].hash != b[i].hash)
+        return false;
+    }
+    return true;
+  }
+}
+
+int main()
+{
+  const std::string data = test::random_data(300000);
+  for (const auto& sizes : std::vector<std::array<std::size_t, 3>>{
+         { 1, 1, 1 }, { 64, 64, 64 }, { 32, 64, 64 }, { 16, 32, 4096 }, { 256, 1024, 8192 }, { 2048, 8192, 65536 } })
+  {
+    // one hash per chunk: small chunks on a part of the data only
+    const std::string sample = sizes[2] < 1024 ? data.substr(0, 10000) : data;
+    const std::vector<files::chunk> chunks = split(sample, sample.size(), sizes);
+    uint64_t offset = 0;
+    bool contiguous = true;
+    bool bounded = true;
+    for (std::size_t i = 0; i < chunks.size(); ++i)
+    {
+      contiguous &= chunks[i].offset == offset;
+      bounded &= chunks[i].length <= sizes[2] && (chunks[i].length >= sizes[0] || i + 1 == chunks.size());
+      offset += chunks[i].length;
+    }
+    CHECK(contiguous);
+    CHECK(bounded);
+    CHECK(offset == sample.size());
+    if (sizes[0] == sizes[2])
+      CHECK(chunks.size() == (sample.size() + sizes[2] - 1) / sizes[2]);
+
+    // the boundaries only depend on the content
+    for (const std::size_t step : { std::size_t(1), std::size_t(7), sizes[0], sizes[2] + 1 })
+      CHECK(same(split(sample, step, sizes), chunks));
+  }
+
+  // chunk hashes and file chunking
+  const test::temp_dir dir("chunker");
+  const std::filesystem::path file = dir / "data";
+  test::write_file(file, data);
+  const std::vector<files::chunk> chunks = files::get_chunks(file, algorithm, 2048, 8192, 65536);
+  CHECK(same(chunks, split(data, 4096, { 2048, 8192, 65536 })));
+  CHECK(!chunks.empty());
+  const std::string first(data.substr(0, static_cast<std::size_t>(chunks.front().length)));
+  CHECK(chunks.front().hash == hashpp::get::getHash(algorithm, first).getString());
+
+  // an insertion only changes the chunks around it
+  const std::string inserted = data.substr(0, 1000) + "inserted" + data.substr(1000);
+  std::set<std::string> before;
+  for (const auto& c : chunks)
+    before.insert(c.hash);
+  std::size_t shared = 0;
+  const std::vector<files::chunk> after = split(inserted, inserted.size(), { 2048, 8192, 65536 });
+  for (const auto& c : after)
+    shared += before.count(c.hash);
+  CHECK(shared + 3 >= after.size());
+
+  // empty stream and invalid sizes
+  CHECK(split(std::string(), 1, { 16, 32, 64 }).empty());
+  test::write_file(file, "");
+  CHECK(files::get_chunks(file).empty());
+  CHECK(test::throws([]() { files::chunker(algorithm, 0, 32, 64); }));
+  CHECK(test::throws([]() { files::chunker(algorithm, 64, 32, 64); }));
+  CHECK(test::throws([]() { files::chunker(algorithm, 16, 128, 64); }));
+  return test::result("chunker");
+}
@@ -0,0 +1,112 @@
+#include <string>
+#include <vector>
+#include <cstring>
+#include <sstream>
+#include <winpp/delta.hpp>
+#include "test.hpp"
+
+// delta: signature and delta round trips through their streams, rejection of truncated
+// and corrupted streams, and of a delta applied to the wrong base
+namespace
+{
+  std::string serialize(const files::signature& sig)
+  {
+    std::stringstream stream;
+    files::write_signature(stream, sig);
+    return stream.str();
+  }
+
+  std::string serialize(const files::delta& d)
+  {
+    std::stringstream stream;
+    files::write_delta(stream, d);
+    return stream.str();
+  }
+
+  files::signature parse_signature(const std::string& data)
+  {
+    std::stringstream stream(data);
+    return files::read_signature(stream);
+  }
+
+  files::delta parse_delta(const std::string& data)
+  {
+    std::stringstream stream(data);
+    return files::read_delta(stream);
+  }
+
+  // overwrite a 64 bits value of a stream
+  std::string patch(std::string data, const std::size_t offset, const uint64_t value)
+  {
+    std::memcpy(&data[offset], &value, sizeof(value));
+    return data;
+  }
+}
+
+int main()
+{
+  const test::temp_dir dir("delta");
+  const std::filesystem::path base = dir / "base";
+  const std::filesystem::path target = dir / "target";
+  const std::filesystem::path output = dir / "output";
+
+  // target: a block removed, a literal run longer than the maximum literal, a modified range
+  const std::string base_data = test::random_data(1024 * 1024);
+  std::string target_data = base_data.substr(0, 300000) + std::string(200000, 'x') + base_data.substr(400000);
+  const std::string noise = test::random_data(100000, 2);
+  target_data.replace(700000, noise.size(), noise);
+  test::write_file(base, base_data);
+  test::write_file(target, target_data);
+
+  // round trip: the signature and the delta go through their streams
+  const files::signature sig = parse_signature(serialize(files::get_signature(base)));
+  const files::delta d = files::get_delta(sig, target);
+  std::size_t copied = 0;
+  std::size_t max_literal = 0;
+  for (const auto& instruction : d.instructions)
+  {
+    if (instruction.kind == files::delta_instruction::type::copy)
+      copied += static_cast<std::size_t>(instruction.length);
+    else
+      max_literal = std::max(max_literal, instruction.data.size());
+  }
+  CHECK(max_literal <= files::max_delta_literal);
+  CHECK(copied >= base_data.size() / 2);
+  const std::string stream = serialize(d);
+  files::apply_delta(base, parse_delta(stream), output);
+  CHECK(test::read_file(output) == target_data);
+
+  // identical and empty targets
+  files::apply_delta(base, files::get_delta(sig, base), output);
+  CHECK(test::read_file(output) == base_data);
+  test::write_file(target, "");
+  files::apply_delta(base, files::get_delta(sig, target), output);
+  CHECK(test::read_file(output).empty());
+
+  // truncated streams
+  const std::string sig_stream = serialize(sig);
+  for (const std::size_t size : { std::size_t(0), std::size_t(7), std::size_t(20), sig_stream.size() / 2, sig_stream.size() - 1 })
+    CHECK(test::throws([&]() { parse_signature(sig_stream.substr(0, size)); }));
+  for (const std::size_t size : { std::size_t(0), std::size_t(12), stream.size() / 2, stream.size() - 1 })
+    CHECK(test::throws([&]() { parse_delta(stream.substr(0, size)); }));
+
+  // corrupted sizes: magic 8, algorithm 4, then the 64 bits sizes
+  const std::size_t sig_hash = 8 + 4 + 8 + 8;
+  CHECK(test::throws([&]() { parse_signature(patch(sig_stream, sig_hash, ~0ull >> 4)); }));
+  CHECK(test::throws([&]() { parse_signature(patch(sig_stream, sig_hash + 8 + sig.hash.size(), ~0ull >> 4)); }));
+  const std::size_t delta_count = 8 + 4 + 8 + 8 + d.hash.size();
+  CHECK(test::throws([&]() { parse_delta(patch(stream, delta_count, ~0ull >> 4)); }));
+  CHECK(test::throws([&]() { parse_delta(patch(stream, 8 + 4 + 8, 1ull << 40)); }));
+  std::string bad_magic = stream;
+  bad_magic[0] = 'X';
+  CHECK(test::throws([&]() { parse_delta(bad_magic); }));
+
+  // a delta applied to another base is rejected by the hash of the output
+  test::write_file(target, target_data);
+  const files::delta original = files::get_delta(sig, target);
+  test::write_file(base, test::random_data(base_data.size(), 3));
+  CHECK(test::throws([&]() { files::apply_delta(base, original, output); }));
+  test::write_file(base, base_data.substr(0, 1000));
+  CHECK(test::throws([&]() { files::apply_delta(base, original, output); }));
+  return test::result("delta");
+}
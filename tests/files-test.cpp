@@ -0,0 +1,142 @@
+#include <set>
+#include <atomic>
+#include <string>
+#include <vector>
+#include <fstream>
+#include <winpp/files.hpp>
+#include "test.hpp"
+
+// files: early stop of path_range, walks with skipped files, read errors, incremental
+// chunked hash with out of range modifications and tree hash of symbolic links
+namespace
+{
+  std::set<std::filesystem::path> as_set(const std::vector<std::filesystem::path>& paths)
+  {
+    return std::set<std::filesystem::path>(paths.begin(), paths.end());
+  }
+}
+
+int main()
+{
+  // path_range: leaving the loop stops the walk, it doesn't run to its end
+  {
+    constexpr std::size_t total = 1000000;
+    constexpr std::size_t batch = 64;
+    std::atomic<std::size_t> visited(0);
+    std::atomic<bool> stopped(false);
+    {
+      files::path_range range([&](const std::function<bool(const std::filesystem::path&)>& callback, std::atomic<bool>& stop) -> bool {
+        for (std::size_t i = 0; i < total; ++i)
+        {
+          if (stop)
+          {
+            stopped = true;
+            return false;
+          }
+          ++visited;
+          if (!callback(std::filesystem::path(std::to_string(i))))
+          {
+            stopped = true;
+            return false;
+          }
+        }
+        return true;
+      }, batch, 4);
+      std::size_t n = 0;
+      for (const auto& p : range)
+      {
+        CHECK(p == std::to_string(n));
+        if (++n == 10)
+          break;
+      }
+    }
+    CHECK(stopped);
+    CHECK(visited <= batch * 6);
+  }
+
+  const test::temp_dir dir("files");
+  const std::filesystem::path root = dir / "tree";
+  std::filesystem::create_directories(root / "a" / "b");
+  std::filesystem::create_directories(root / "c");
+  for (const auto& file : { "a/one.txt", "a/b/two.txt", "a/b/three.log", "c/four.txt", "five.txt" })
+    test::write_file(root / std::filesystem::u8path(file), file);
+
+  // lazy and eager walks give the same files, the lazy one can be left early
+  const std::vector<std::filesystem::path> all = files::get_files(root);
+  CHECK(all.size() == 5);
+  std::vector<std::filesystem::path> scanned;
+  for (const auto& p : files::scan_files(root))
+    scanned.push_back(p);
+  CHECK(as_set(scanned) == as_set(all));
+  std::size_t first = 0;
+  for (const auto& p : files::scan_files(root, files::infinite_depth, false, files::all_dirs, std::regex(R"(.*\.txt)")))
+  {
+    CHECK(p.extension() == ".txt");
+    if (++first == 2)
+      break;
+  }
+  CHECK(first == 2);
+
+  // skipped files are found by identity during the walk and outside of it
+  const std::filesystem::path skipped = root / "a" / "b" / "two.txt";
+  const std::vector<std::filesystem::path> kept = files::get_files(root, files::infinite_depth, false, files::all_dirs, files::all_files, {}, { skipped });
+  CHECK(kept.size() == 4);
+  CHECK(as_set(kept).count(skipped) == 0);
+  const files::file_id_set ids({ skipped });
+  CHECK(ids.contains(skipped));
+  CHECK(!ids.contains(root / "a" / "one.txt"));
+  CHECK(!ids.contains(root / "missing.txt"));
+
+  // read errors are reported instead of returning partial data
+  CHECK(files::read(root / "five.txt") == "five.txt");
+  CHECK(test::throws([&]() { files::read(root / "missing.txt"); }));
+  CHECK(test::throws([&]() { files::read(root / "a"); }));
+  CHECK(test::throws([&]() { files::get_hash(root / "a"); }));
+  CHECK(files::get_hash(root / "five.txt") == hashpp::get::getHash(hashpp::ALGORITHMS::SHA2_256, "five.txt").getString());
+
+  // chunked hash: the modified ranges are clipped to the file
+  {
+    const std::filesystem::path file = dir / "chunked";
+    std::string data = test::random_data(10000);
+    test::write_file(file, data);
+    files::chunked_hash hash = files::get_chunked_hash(file, hashpp::ALGORITHMS::SHA2_256, 1024);
+    data[3000] = static_cast<char>(data[3000] + 1);
+    test::write_file(file, data);
+    files::update_chunked_hash(file, hash, { { 2999, ~0ull }, { ~0ull - 5, 100 }, { 50000, 10 } });
+    CHECK(hash.levels == files::get_chunked_hash(file, hashpp::ALGORITHMS::SHA2_256, 1024).levels);
+    data += test::random_data(5000, 2);
+    test::write_file(file, data);
+    files::update_chunked_hash(file, hash);
+    CHECK(hash.levels == files::get_chunked_hash(file, hashpp::ALGORITHMS::SHA2_256, 1024).levels);
+  }
+
+  // tree hash: symbolic links are entries of their own, never followed
+  {
+    const files::tree_hash before = files::get_tree_hash(root);
+    CHECK(before.files.size() == 5);
+    CHECK(before.dirs.size() == 4);
+    std::error_code ec;
+    std::filesystem::create_directory_symlink("../c", root / "a" / "dir-link", ec);
+    if (!ec)
+      std::filesystem::create_symlink("one.txt", root / "a" / "file-link", ec);
+    if (!ec)
+    {
+      const files::tree_hash links = files::get_tree_hash(root);
+      CHECK(links.root() != before.root());
+      CHECK(links.files.size() == 5);
+      CHECK(links.dirs.size() == 4);
+      CHECK(links.links.size() == 2);
+      CHECK(links.links.at("a/file-link") == hashpp::get::getHash(hashpp::ALGORITHMS::SHA2_256, "one.txt").getString());
+
+      // the target content isn't part of the digest, the target path is
+      test::write_file(root / "a" / "one.txt", "changed");
+      const files::tree_hash changed = files::get_tree_hash(root);
+      CHECK(changed.links == links.links);
+      CHECK(changed.dirs.at("c") == links.dirs.at("c"));
+      std::filesystem::remove(root / "a" / "file-link");
+      std::filesystem::create_symlink("b/two.txt", root / "a" / "file-link");
+      CHECK(files::get_tree_hash(root).links.at("a/file-link") != links.links.at("a/file-link"));
+    }
+  }
+  return test::result("files");
+}
@@ -0,0 +1,112 @@
+#include <string>
+#include <vector>
+#include <cstddef>
+#include <cstring>
+#include <winpp/hash-index.hpp>
+#include "test.hpp"
+
+// hash_index: build and lookup round trip (with and without the bloom filter), rejection
+// of truncated and corrupted index files (offsets and sizes that would wrap around)
+namespace
+{
+  constexpr hashpp::ALGORITHMS algorithm = hashpp::ALGORITHMS::SHA2_256;
+
+  // write a copy of an index file with a 64 bits value of the header overwritten
+  void patch(const std::string& data, const std::filesystem::path& path, const std::size_t offset, const uint64_t value)
+  {
+    std::string copy = data;
+    std::memcpy(&copy[offset], &value, sizeof(value));
+    test::write_file(path, copy);
+  }
+}
+
+int main()
+{
+  const test::temp_dir dir("hash-index");
+  const std::size_t digest_size = hashpp::digestSize(algorithm);
+
+  // random digests, the second half is never added to the index
+  const std::size_t count = 20000;
+  const std::string digests = test::random_data(2 * count * digest_size);
+  const uint8_t* known = reinterpret_cast<const uint8_t*>(digests.data());
+  const uint8_t* unknown = known + count * digest_size;
+
+  for (const std::size_t bloom_bits : { files::default_bloom_bits, std::size_t(0) })
+  {
+    const std::filesystem::path path = dir / "binary.idx";
+    files::hash_index::build(path, algorithm, known, count, bloom_bits);
+    const files::hash_index index(path);
+    CHECK(index.algorithm() == algorithm);
+    CHECK(index.digest_size() == digest_size);
+    CHECK(index.size() == count);
+    std::size_t found = 0;
+    std::size_t false_positives = 0;
+    for (std::size_t i = 0; i < count; ++i)
+    {
+      found += index.contains(known + i * digest_size) ? 1 : 0;
+      false_positives += index.contains(unknown + i * digest_size) ? 1 : 0;
+    }
+    CHECK(found == count);
+    CHECK(false_positives == 0);
+  }
+
+  // hexadecimal digests (duplicates are merged) and files
+  test::write_file(dir / "a.txt", "a");
+  test::write_file(dir / "b.txt", "b");
+  const std::string hash_a = files::get_hash(dir / "a.txt", algorithm);
+  const std::filesystem::path hex_path = dir / "hex.idx";
+  files::hash_index::build(hex_path, algorithm, std::vector<std::string>{ hash_a, hash_a });
+  {
+    const files::hash_index index(hex_path);
+    CHECK(index.size() == 1);
+    CHECK(index.contains(hash_a));
+    CHECK(index.contains_file(dir / "a.txt"));
+    CHECK(!index.contains_file(dir / "b.txt"));
+    CHECK(!index.contains(std::string("not an hexadecimal digest")));
+  }
+  CHECK(test::throws([&]() { files::hash_index::build(hex_path, algorithm, std::vector<std::string>{ "xyz" }); }));
+
+  // empty index
+  const std::filesystem::path empty_path = dir / "empty.idx";
+  files::hash_index::build(empty_path, algorithm, known, 0);
+  {
+    const files::hash_index index(empty_path);
+    CHECK(index.size() == 0);
+    CHECK(!index.contains(known));
+  }
+
+  // truncated files
+  const std::filesystem::path path = dir / "binary.idx";
+  files::hash_index::build(path, algorithm, known, count);
+  const std::string data = test::read_file(path);
+  const std::filesystem::path bad = dir / "bad.idx";
+  for (const std::size_t size : { std::size_t(0), std::size_t(32), data.size() / 2, data.size() - 1 })
+  {
+    test::write_file(bad, data.substr(0, size));
+    CHECK(test::throws([&]() { files::hash_index index(bad); }));
+  }
+
+  // corrupted header
+  using header = files::details::hash_index_header;
+  for (const auto& [offset, value] : std::vector<std::pair<std::size_t, uint64_t>>{
+         { offsetof(header, digest_size), 20 },
+         { offsetof(header, count), count + 1 },
+         { offsetof(header, count), ~0ull / digest_size + 1 },
+         { offsetof(header, bloom_bits), 3 },
+         { offsetof(header, bloom_bits), 1ull << 62 },
+         { offsetof(header, bloom_hashes), 0 },
+         { offsetof(header, bloom_hashes), 17 },
+         { offsetof(header, bloom_hashes), 1ull << 40 },
+         { offsetof(header, bloom_offset), 0 },
+         { offsetof(header, bloom_offset), ~0ull - 4 },
+         { offsetof(header, table_offset), ~0ull - 8 } })
+  {
+    patch(data, bad, offset, value);
+    CHECK(test::throws([&]() { files::hash_index index(bad); }));
+  }
+  std::string bad_magic = data;
+  bad_magic[0] = 'X';
+  test::write_file(bad, bad_magic);
+  CHECK(test::throws([&]() { files::hash_index index(bad); }));
+  return test::result("hash-index");
+}
@@ -0,0 +1,74 @@
+#include <regex>
+#include <random>
+#include <string>
+#include <vector>
+#include <winpp/pattern.hpp>
+#include "test.hpp"
+
+// pattern: differential test of pattern::regex against std::regex_search (fixed and random
+// inputs, case sensitive or not), globs and the expressions that are rejected
+int main()
+{
+  const std::vector<std::string> regexes = {
+    R"(\.(tmp|bak)$|~$)", "^ab|cd$", "a|^b", "^a$|b", "^$", "$", "^", "a|", "^(ab|c)d$", "x\\$", "^a.*z$|^q",
+    "(a|b)+c$|^d", "^\\d+$|\\.txt$", "a$|^$", "ab|^", "[$^]x", "^[^a]b$", "a?b*c+", "(ab)*$", "[a-c]+\\.d", "\\w\\s\\w",
+    "a.c", "^\\.", "(a|)b", "((a|b)c)+d$"
+  };
+  std::vector<std::string> inputs = {
+    "", "a", "b", "ab", "cd", "abcd", "xab", "cdx", "file.tmp", "file.tmp.x", "x.bak", "foo~", "~foo", "ba", "abd",
+    "x$", "x$y", "az", "abz", "q", "xq", "abc", "c", "d", "dd", "123", "12a", "a.txt", "$x", "^x", "bb", "cb",
+    "ABC", "File.TMP", "a c", ".d", "abab", "acbcd", "aXc"
+  };
+
+  // random inputs over the characters used by the expressions
+  std::mt19937 rng(1);
+  const std::string alphabet = "abcdqxz.$^~1 ";
+  for (int i = 0; i < 2000; ++i)
+  {
+    std::string input(rng() % 8, 0);
+    for (auto& c : input)
+      c = alphabet[rng() % alphabet.size()];
+    inputs.push_back(input);
+  }
+
+  for (const bool ignore_case : { false, true })
+  {
+    for (const auto& expression : regexes)
+    {
+      const files::pattern compiled = files::pattern::regex(expression, ignore_case);
+      const std::regex reference(expression, ignore_case ? std::regex::ECMAScript | std::regex::icase : std::regex::ECMAScript);
+      std::size_t mismatches = 0;
+      for (const auto& input : inputs)
+      {
+        if (compiled.matches(std::string_view(input)) != std::regex_search(input, reference))
+        {
+          if (++mismatches == 1)
+            std::cerr << fmt::format("\"{}\" on \"{}\" (ignore case: {})", expression, input, ignore_case) << std::endl;
+        }
+      }
+      CHECK(mismatches == 0);
+    }
+  }
+
+  // globs: the whole name has to match
+  const files::pattern headers = files::pattern::glob("*.{h,hpp};Makefile");
+  CHECK(headers.matches(std::string_view("files.hpp")));
+  CHECK(headers.matches(std::string_view("a.h")));
+  CHECK(headers.matches(std::string_view("Makefile")));
+  CHECK(!headers.matches(std::string_view("files.hpp.bak")));
+  CHECK(!headers.matches(std::string_view("dir/a.h")));
+  CHECK(!headers.matches(std::string_view("makefile")));
+  CHECK(files::pattern::glob("*.txt", true).matches(std::string_view("README.TXT")));
+  CHECK(files::pattern::glob("**/*.c").matches(std::string_view("src/lib/a.c")));
+  CHECK(files::pattern::glob("**/*.c").matches(std::string_view("a.c")));
+  CHECK(files::pattern::glob("file?.[a-c]").matches(std::string_view("file1.b")));
+  CHECK(!files::pattern::glob("file?.[!a-c]").matches(std::string_view("file1.b")));
+  CHECK(headers.matches_filename(std::filesystem::path("include") / "winpp" / "files.hpp"));
+  CHECK(!headers.matches_filename(std::filesystem::path("files.hpp") / "readme.md"));
+  CHECK(files::pattern().matches(std::string_view("anything")));
+
+  // anchors which can't be compiled are rejected instead of being matched differently
+  for (const char* expression : { "(^a)", "a^b", "(a$)", "a$b", "a$$" })
+    CHECK(test::throws([&]() { files::pattern::regex(expression); }));
+  return test::result("pattern");
+}
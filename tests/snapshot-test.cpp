@@ -0,0 +1,99 @@
+#include <string>
+#include <cstddef>
+#include <cstring>
+#include <algorithm>
+#include <winpp/snapshot.hpp>
+#include "test.hpp"
+
+// snapshot: scan, save and map round trip, diff of the changes, rejection of truncated
+// and corrupted files (offsets and sizes that would wrap around)
+namespace
+{
+  // write a copy of a snapshot file with a 64 bits value overwritten
+  void patch(const std::string& data, const std::filesystem::path& path, const std::size_t offset, const uint64_t value)
+  {
+    std::string copy = data;
+    std::memcpy(&copy[offset], &value, sizeof(value));
+    test::write_file(path, copy);
+  }
+}
+
+int main()
+{
+  const test::temp_dir dir("snapshot");
+  const std::filesystem::path root = dir / "tree";
+  std::filesystem::create_directories(root / "a" / "b");
+  std::filesystem::create_directories(root / "c");
+  test::write_file(root / "a" / "one.txt", "1");
+  test::write_file(root / "a" / "b" / "two.txt", "22");
+  test::write_file(root / "three.txt", "333");
+
+  // round trip through a file
+  const files::snapshot scanned = files::snapshot::scan(root);
+  CHECK(scanned.size() == 7);
+  const std::filesystem::path file = dir / "tree.snap";
+  scanned.save(file);
+  const files::snapshot loaded(file);
+  CHECK(loaded.size() == scanned.size());
+  CHECK(files::diff(scanned, loaded).empty());
+  for (std::size_t i = 0; i < loaded.size(); ++i)
+  {
+    CHECK(loaded[i].path == scanned[i].path);
+    CHECK(loaded[i].size == scanned[i].size);
+    CHECK(loaded[i].type == scanned[i].type);
+  }
+  const auto two = loaded.find("a/b/two.txt");
+  CHECK(two && two->size == 2 && two->name() == "two.txt" && two->type == files::entry_type::file);
+  CHECK(loaded.find("a/b") && loaded.find("a/b")->type == files::entry_type::directory);
+  CHECK(!loaded.find("a/missing.txt"));
+  const auto children = loaded.children("a");
+  CHECK(children.second - children.first == 2);
+
+  // changes found against the saved state
+  test::write_file(root / "a" / "one.txt", "changed");
+  test::write_file(root / "c" / "four.txt", "4");
+  std::filesystem::remove(root / "three.txt");
+  files::snapshot after;
+  const files::snapshot_diff changes = files::diff(loaded, root, &after);
+  CHECK(changes.added == std::vector<std::string>{ "c/four.txt" });
+  CHECK(changes.removed == std::vector<std::string>{ "three.txt" });
+  CHECK(changes.modified == std::vector<std::string>{ "a/one.txt" });
+  CHECK(files::diff(after, files::snapshot::scan(root)).empty());
+
+  // truncated files
+  const std::string data = test::read_file(file);
+  const std::filesystem::path bad = dir / "bad.snap";
+  for (const std::size_t size : { std::size_t(0), std::size_t(16), data.size() / 2, data.size() - 1 })
+  {
+    test::write_file(bad, data.substr(0, size));
+    CHECK(test::throws([&]() { files::snapshot s(bad); }));
+  }
+
+  // corrupted header: magic 8, version 4, record_size 4, count, records_offset, names_offset, names_size
+  const std::size_t count = 16;
+  const std::size_t records_offset = 24;
+  const std::size_t names_offset = 32;
+  const std::size_t names_size = 40;
+  for (const auto& [offset, value] : std::vector<std::pair<std::size_t, uint64_t>>{
+         { count, ~0ull / sizeof(files::details::snapshot_record) + 2 },
+         { count, scanned.size() + 1 },
+         { records_offset, 0 },
+         { names_offset, ~0ull - 10 },
+         { names_size, ~0ull - 10 },
+         { names_size, data.size() } })
+  {
+    patch(data, bad, offset, value);
+    CHECK(test::throws([&]() { files::snapshot s(bad); }));
+  }
+
+  // corrupted record: its path out of the names
+  uint64_t first_record = 0;
+  std::memcpy(&first_record, &data[records_offset], sizeof(first_record));
+  patch(data, bad, static_cast<std::size_t>(first_record + offsetof(files::details::snapshot_record, path_offset)), ~0ull - 1);
+  CHECK(test::throws([&]() { files::snapshot s(bad); }));
+  std::string bad_magic = data;
+  bad_magic[0] = 'X';
+  test::write_file(bad, bad_magic);
+  CHECK(test::throws([&]() { files::snapshot s(bad); }));
+  return test::result("snapshot");
+}
@@ -0,0 +1,108 @@
+#pragma once
+#include <string>
+#include <random>
+#include <fstream>
+#include <iostream>
+#include <iterator>
+#include <exception>
+#include <filesystem>
+#include <fmt/format.h>
+
+// minimal checks shared by the tests: each test is an executable run by ctest,
+// a failed check is reported and the test exits with 1 once all the checks ran
+namespace test
+{
+  inline int& failures()
+  {
+    static int count = 0;
+    return count;
+  }
+
+  inline void check(const bool ok, const char* expr, const char* file, const int line)
+  {
+    if (ok)
+      return;
+    ++failures();
+    std::cerr << fmt::format("{}:{}: check failed: {}", file, line, expr) << std::endl;
+  }
+
+  // true if the call throws an exception
+  template <class F>
+  inline bool throws(F&& f)
+  {
+    try
+    {
+      f();
+    }
+    catch (const std::exception&)
+    {
+      return true;
+    }
+    return false;
+  }
+
+  // exit code of the test
+  inline int result(const char* name)
+  {
+    std::cout << fmt::format("{}: {}", name, failures() ? fmt::format("{} failed check(s)", failures()) : "ok") << std::endl;
+    return failures() ? 1 : 0;
+  }
+
+  // pseudo-random content (fixed seed: the tests are reproducible)
+  inline std::string random_data(const std::size_t size, const uint32_t seed = 1)
+  {
+    std::mt19937 rng(seed);
+    std::string data(size, 0);
+    for (auto& c : data)
+      c = static_cast<char>(rng());
+    return data;
+  }
+
+  inline void write_file(const std::filesystem::path& path, const std::string& data)
+  {
+    std::ofstream file(path, std::ios::binary | std::ios::trunc);
+    file.write(data.data(), static_cast<std::streamsize>(data.size()));
+  }
+
+  inline std::string read_file(const std::filesystem::path& path)
+  {
+    std::ifstream file(path, std::ios::binary);
+    return std::string(std::istreambuf_iterator<char>(file), std::istreambuf_iterator<char>());
+  }
+
+  // empty directory removed at the end of the test
+  class temp_dir final
+  {
+    temp_dir(const temp_dir&) = delete;
+    temp_dir& operator=(const temp_dir&) = delete;
+
+  public:
+    explicit temp_dir(const std::string& name) :
+      m_path(std::filesystem::temp_directory_path() / fmt::format("winpp-{}-{}", name, std::random_device()()))
+    {
+      std::filesystem::remove_all(m_path);
+      std::filesystem::create_directories(m_path);
+    }
+
+    ~temp_dir()
+    {
+      std::error_code ec;
+      std::filesystem::remove_all(m_path, ec);
+    }
+
+    const std::filesystem::path& path() const
+    {
+      return m_path;
+    }
+
+    std::filesystem::path operator/(const std::filesystem::path& rel) const
+    {
+      return m_path / rel;
+    }
+
+  private:
+    std::filesystem::path m_path;
+  };
+}
+
+#define CHECK(expr) test::check(static_cast<bool>(expr), #expr, __FILE__, __LINE__)